@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+typedef struct batch_config {
+	const char *romPath;
+	uint32_t instances; // Number of independent machines
+	uint32_t threads; // Largest worker pool to measure (0 -> online CPUs)
+	uint64_t frames; // Frames every instance runs
+	uint8_t idleSkip; // Skip the idle loops (see idle_loop.h)
+} batch_config_t;
+
+// Run config->instances headless machines for config->frames each, once with
+// 1, 2, 4, ... up to config->threads worker threads, and print the aggregate
+// frames per second and the scaling efficiency of every run. Returns 0 if
+// the configuration can't be run.
+uint8_t runBatch(const batch_config_t *config);
@@ -1,13 +1,16 @@
 #pragma once
 #include <stdint.h>
 
+#include "rom_cache.h"
+
 /*
  *   Memory Map:
  *
- *   0000-1FFF 8K ROM
+ *   0000-1FFF 8K ROM (writes are ignored)
  *   2000-23FF 1K RAM
  *   2400-3FFF 7K Video RAM
- *   4000-???? ?k RAM mirror
+ *   4000-7FFF RAM mirror (0x2000 - 0x3FFF)
+ *   8000-FFFF Mirror of 0000-7FFF (A15 is not decoded)
  *
  */
 typedef struct memory {
@@ -16,17 +19,69 @@ typedef struct memory {
 	uint8_t vram[0x1C00]; // 7KB of VRAM
 } memory_t;
 
-// Clear the memory
-void initBus(memory_t *memory);
+// The address space is split into 256 pages of 256 bytes each
+#define PAGE_SIZE 0x100
+#define PAGE_COUNT 0x100
+
+// Address decoding of one machine, every page table entry points to the
+// start of a page (use the functions below instead of accessing it directly)
+typedef struct bus {
+	uint8_t *readPages[PAGE_COUNT];
+	uint8_t *writePages[PAGE_COUNT];
+	// 0xFFFFFFFF for every page that is (a mirror of) VRAM, 0 otherwise
+	uint32_t vramPageMask[PAGE_COUNT];
+	// One bit per VRAM byte column (see vram_convert.h) written since the
+	// last call to takeDirtyStripes()
+	uint32_t dirtyStripes;
+	uint8_t discardPage[PAGE_SIZE]; // Writes to the ROM end up here
+	memory_t *memory;
+	rom_cache_t romCache;
+} bus_t;
+
+// Clear the memory and map it into the address space
+void initBus(bus_t *bus, memory_t *memory);
+
+// Map 64 KB of flat, writable memory into the whole address space instead
+// of the Space Invaders board (for the CPU tests). The memory can be
+// written anywhere, so the ROM cache is turned off.
+void mapFlatMemory(bus_t *bus, uint8_t *memory);
 
 // Load the provided ROM into memory
-void loadROM(char *path);
+void loadROM(bus_t *bus, const char *path);
+
+// Read a ROM file into rom (ROM_SIZE bytes), exits on failure
+void readROMFile(const char *path, uint8_t *rom);
+
+// Copy a ROM read by readROMFile() into memory (no file access, no output)
+void setROM(bus_t *bus, const uint8_t *rom);
 
 // Write a byte to a given address in memory
-void writeByteToMemory(uint8_t data, uint16_t address);
+void writeByteToMemory(bus_t *bus, uint8_t data, uint16_t address);
+
+// Return a pointer to the given address (only for reading, writes need to go
+// through writeByteToMemory)
+uint8_t *getAddressPointer(const bus_t *bus, uint16_t address);
+
+// Return the value stored at the given address
+static inline uint8_t readMemoryValue(const bus_t *bus, uint16_t address)
+{
+	return bus->readPages[address >> 8][address & 0xFF];
+}
+
+// Return the little endian 16-Bit value stored at address and address + 1
+static inline uint16_t readMemoryWord(const bus_t *bus, uint16_t address)
+{
+	const uint8_t *page = bus->readPages[address >> 8];
+	uint8_t offset = address & 0xFF;
+
+	// Both bytes are in the same page, skip the second lookup
+	if (offset != 0xFF) {
+		return page[offset] | page[offset + 1] << 8;
+	}
 
-// Return a pointer to the given address
-uint8_t *getAddressPointer(uint16_t address);
+	return page[offset] | readMemoryValue(bus, address + 1) << 8;
+}
 
-// Wrapper around getAddressPointer which only returns the value
-uint8_t readMemoryValue(uint16_t address);
+// Return the VRAM stripes written since the last call and reset them
+// (Bit n is set if the byte column n was written, see vram_convert.h)
+uint32_t takeDirtyStripes(bus_t *bus);
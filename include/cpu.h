@@ -9,8 +9,31 @@ typedef union _reg {
 	uint16_t reg;
 } reg_t;
 
+// Instruction that produced the pending (not yet computed) flags
+enum LAZY_OP {
+	LAZY_NONE, // Flags in F are up to date
+	LAZY_ADD, // ADD, ADC, ADI, ACI
+	LAZY_SUB, // SUB, SBB, SUI, SBI, CMP, CPI
+	LAZY_INR,
+	LAZY_DCR,
+	LAZY_ANA, // ANA, ANI
+	LAZY_LOGIC // XRA, XRI, ORA, ORI
+};
+
+// Operands and result of the last ALU instruction, the flags are only
+// computed from these if something reads them (see flags.h)
+typedef struct lazy_flags {
+	uint8_t op; // enum LAZY_OP
+	uint8_t byte1;
+	uint8_t byte2;
+	uint8_t result;
+	uint8_t carry; // Carry-in of ADD/SUB, Carry before INR/DCR (kept)
+} lazy_flags_t;
+
+struct machine;
+
 typedef struct cpu {
-	uint8_t io_port[0x8];
+	struct machine *machine; // Memory and I/O (see machine.h)
 	reg_t AF; // Register Pair A and Flags
 	reg_t BC; // Register Pair B and C
 	reg_t DE; // Register Pair D and E
@@ -20,6 +43,12 @@ typedef struct cpu {
 	uint8_t opcode;
 	uint8_t interrupt;
 	uint8_t interrupt_enabled;
+	uint8_t halted; // Waiting in HLT for an interrupt
+	lazy_flags_t lazy;
+	uint64_t instructions; // Executed instructions since initCPU
+#ifdef LAZY_FLAGS_VALIDATE
+	uint8_t eager_flags; // Flags computed the old (eager) way
+#endif
 } cpu_t;
 
 // Initialize the CPU Registers
@@ -28,5 +57,19 @@ void initCPU(cpu_t *cpu);
 // Fetch next instruction, execute it and return the cycles it took
 uint8_t step(cpu_t *cpu);
 
-// Set the Interrupt Subroutine (Interrupts need to be enabled)
+// Handler of every opcode, executes the instruction at PC (without fetching
+// it) and returns the cycles it took
+extern uint8_t (*const opcodeHandlers[256])(cpu_t *cpu);
+
+// Execute instructions until at least budget cycles have been used, return
+// the cycles it took. Same as calling step() in a loop, but faster.
+uint32_t step_cycles(cpu_t *cpu, uint32_t budget);
+
+// Request an interrupt with the given RST opcode. It stays pending until
+// interrupts are enabled, a newer request replaces a pending one.
 void setInterruptRoutine(cpu_t *cpu, uint8_t interrupt);
+
+// Exit the program and print the last cpu state to the console
+void cpu_crash(cpu_t *cpu, char *file, int line);
+
+#define CPU_CRASH(cpu) cpu_crash(cpu, __FILE__, __LINE__)
@@ -0,0 +1,545 @@
+#pragma once
+#include <stdio.h>
+
+#include "bus.h"
+#include "flags.h"
+#include "machine.h"
+#include "shift_register.h"
+
+// Semantics of every 8080 instruction as macros, expanded once per opcode
+// with OPCODE_TABLE (see opcodes.h). The code using them decides where the
+// CPU state lives by defining:
+//
+//	REG_A, REG_F, REG_B, REG_C, REG_D, REG_E, REG_H, REG_L
+//	REG_BC, REG_DE, REG_HL, REG_SP, REG_PC  16 bit lvalues
+//	LAZY             lazy_flags_t lvalue
+//	INT_ENABLED      interrupt enable lvalue
+//	HALTED           halt flag lvalue
+//	CYCLES           extra cycles of taken branches are added here
+//	MACHINE          machine_t pointer (memory, shift register, I/O ports)
+//	CRASH()          write back the state and call CPU_CRASH
+//
+// OP_xxx(x, y) executes one instruction, including the update of REG_PC.
+
+#define MEM_READ(address) readMemoryValue(&MACHINE->bus, address)
+#define MEM_READ16(address) readMemoryWord(&MACHINE->bus, address)
+#define MEM_WRITE(address, value)                    \
+	writeByteToMemory(&MACHINE->bus, value, address)
+#define IO_PORT(port) MACHINE->io_port[port]
+#define SHIFT_REGISTER (&MACHINE->shiftRegister)
+
+// Operand after the opcode
+#define IMM8() MEM_READ(REG_PC + 1)
+#define IMM16() MEM_READ16(REG_PC + 1)
+
+// 8 bit operands, M is the memory at HL
+#define GET8(r) GET8_##r
+#define GET8_A REG_A
+#define GET8_B REG_B
+#define GET8_C REG_C
+#define GET8_D REG_D
+#define GET8_E REG_E
+#define GET8_H REG_H
+#define GET8_L REG_L
+#define GET8_M MEM_READ(REG_HL)
+
+#define SET8(r, value) SET8_##r(value)
+#define SET8_A(value) (REG_A = (value))
+#define SET8_B(value) (REG_B = (value))
+#define SET8_C(value) (REG_C = (value))
+#define SET8_D(value) (REG_D = (value))
+#define SET8_E(value) (REG_E = (value))
+#define SET8_H(value) (REG_H = (value))
+#define SET8_L(value) (REG_L = (value))
+#define SET8_M(value) MEM_WRITE(REG_HL, value)
+
+// 16 bit operands, PSW is A and the (resolved) flags
+#define REG16(rp) REG_##rp
+
+#define GET16(rp) GET16_##rp
+#define GET16_BC REG_BC
+#define GET16_DE REG_DE
+#define GET16_HL REG_HL
+#define GET16_PSW (RESOLVE_FLAGS(), (uint16_t)(REG_A << 8 | REG_F))
+
+#define SET16(rp, value) SET16_##rp(value)
+#define SET16_BC(value) (REG_BC = (value))
+#define SET16_DE(value) (REG_DE = (value))
+#define SET16_HL(value) (REG_HL = (value))
+// The unused bits of F always read as 0, except bit 1
+#define SET16_PSW(value)                                         \
+	(REG_A = (value) >> 8, REG_F = ((value) & FLAGS_ALL) | 0x02, \
+	 LAZY.op = LAZY_NONE)
+
+// Flags
+#define GET_FLAG(flag) lazy_get_flag(REG_F, &LAZY, flag)
+#define GET_CARRY() lazy_get_carry(REG_F, &LAZY)
+#define SET_LAZY(op, byte1, byte2, carry, result)              \
+	lazy_record(&LAZY, REG_F, op, byte1, byte2, carry, result)
+#define RESOLVE_FLAGS()                                         \
+	(REG_F = lazy_get_flags(REG_F, &LAZY), LAZY.op = LAZY_NONE)
+#define SET_CARRY(carry) (REG_F = (REG_F & ~CARRY) | ((carry) ? CARRY : 0))
+
+// Conditions
+#define COND(cc) COND_##cc
+#define COND_NZ (!GET_FLAG(ZERO))
+#define COND_Z GET_FLAG(ZERO)
+#define COND_NC (!GET_FLAG(CARRY))
+#define COND_C GET_FLAG(CARRY)
+#define COND_PO (!GET_FLAG(PARITY))
+#define COND_PE GET_FLAG(PARITY)
+#define COND_P (!GET_FLAG(SIGN))
+#define COND_M GET_FLAG(SIGN)
+
+// Stack
+#define PUSH16(value)                          \
+	do {                                       \
+		uint16_t pushed_ = (value);            \
+		MEM_WRITE(REG_SP - 1, pushed_ >> 8);   \
+		MEM_WRITE(REG_SP - 2, pushed_ & 0xFF); \
+		REG_SP -= 2;                           \
+	} while (0)
+
+#define POP16(dest)                            \
+	do {                                       \
+		uint16_t popped_ = MEM_READ16(REG_SP); \
+		REG_SP += 2;                           \
+		dest;                                  \
+	} while (0)
+
+// Arithmetic, ADC/SBB pass the Carry as carry-in. The flags come from the
+// 9 bit result, so the carry-in is kept in the lazy record.
+#define ALU_ADD(value, carry)                                 \
+	do {                                                      \
+		uint8_t operand_ = (value);                           \
+		uint8_t carry_ = (carry);                             \
+		uint8_t result_ = REG_A + operand_ + carry_;          \
+		SET_LAZY(LAZY_ADD, REG_A, operand_, carry_, result_); \
+		REG_A = result_;                                      \
+	} while (0)
+
+#define ALU_SUB(value, carry)                                 \
+	do {                                                      \
+		uint8_t operand_ = (value);                           \
+		uint8_t carry_ = (carry);                             \
+		uint8_t result_ = REG_A - operand_ - carry_;          \
+		SET_LAZY(LAZY_SUB, REG_A, operand_, carry_, result_); \
+		REG_A = result_;                                      \
+	} while (0)
+
+#define ALU_CMP(value)                                                       \
+	do {                                                                     \
+		uint8_t operand_ = (value);                                          \
+		SET_LAZY(LAZY_SUB, REG_A, operand_, 0, (uint8_t)(REG_A - operand_)); \
+	} while (0)
+
+// ANA and ANI
+#define ALU_ANA(value)                                   \
+	do {                                                 \
+		uint8_t operand_ = (value);                      \
+		uint8_t result_ = REG_A & operand_;              \
+		SET_LAZY(LAZY_ANA, REG_A, operand_, 0, result_); \
+		REG_A = result_;                                 \
+	} while (0)
+
+// XRA, XRI, ORA and ORI clear Carry and Auxiliary Carry
+#define ALU_LOGIC(operator, value)            \
+	do {                                      \
+		REG_A operator(value);                \
+		SET_LAZY(LAZY_LOGIC, 0, 0, 0, REG_A); \
+	} while (0)
+
+// Instructions
+
+// No Operation
+#define OP_NOP(x, y) (REG_PC += 1)
+
+// Load next 2 Bytes into a Register Pair
+#define OP_LXI(rp, y) (REG16(rp) = IMM16(), REG_PC += 3)
+
+// Increase Register by 1, flags NOT affected
+#define OP_INX(rp, y) (REG16(rp)++, REG_PC += 1)
+
+// Decrease Register by 1, flags NOT affected
+#define OP_DCX(rp, y) (REG16(rp)--, REG_PC += 1)
+
+// Store Accumulator at the address stored in BC or DE
+#define OP_STAX(rp, y) (MEM_WRITE(REG16(rp), REG_A), REG_PC += 1)
+
+// Load byte at the address stored in BC or DE into Accumulator
+#define OP_LDAX(rp, y) (REG_A = MEM_READ(REG16(rp)), REG_PC += 1)
+
+// Increase Register or Memory by 1, flags affected
+#define OP_INR(r, y)                               \
+	do {                                           \
+		uint8_t value_ = GET8(r);                  \
+		uint8_t result_ = value_ + 1;              \
+		SET8(r, result_);                          \
+		SET_LAZY(LAZY_INR, value_, 1, 0, result_); \
+		REG_PC += 1;                               \
+	} while (0)
+
+// Decrease Register or Memory by 1, flags affected
+#define OP_DCR(r, y)                               \
+	do {                                           \
+		uint8_t value_ = GET8(r);                  \
+		uint8_t result_ = value_ - 1;              \
+		SET8(r, result_);                          \
+		SET_LAZY(LAZY_DCR, value_, 1, 0, result_); \
+		REG_PC += 1;                               \
+	} while (0)
+
+// Move next byte into Register or memory location
+#define OP_MVI(r, y)     \
+	do {                 \
+		SET8(r, IMM8()); \
+		REG_PC += 2;     \
+	} while (0)
+
+// Move register or memory content into another register or memory address
+#define OP_MOV(d, s)      \
+	do {                  \
+		SET8(d, GET8(s)); \
+		REG_PC += 1;      \
+	} while (0)
+
+// Left shift Accumulator, Bit 7 will be transfered to Bit0 and Carry
+#define OP_RLC(x, y)                  \
+	do {                              \
+		uint8_t bit7_ = REG_A >> 7;   \
+		RESOLVE_FLAGS();              \
+		REG_A = (REG_A << 1) | bit7_; \
+		SET_CARRY(bit7_);             \
+		REG_PC += 1;                  \
+	} while (0)
+
+// Right shift Accumulator, Bit 0 will be transfered to Bit7 and Carry
+#define OP_RRC(x, y)                         \
+	do {                                     \
+		uint8_t bit0_ = REG_A & 1;           \
+		RESOLVE_FLAGS();                     \
+		REG_A = (REG_A >> 1) | (bit0_ << 7); \
+		SET_CARRY(bit0_);                    \
+		REG_PC += 1;                         \
+	} while (0)
+
+// Left shift Accumulator, Bit 7 will be transfered to carry and original carry
+// will be transfered to bit0
+#define OP_RAL(x, y)                   \
+	do {                               \
+		uint8_t carry_ = GET_CARRY();  \
+		uint8_t bit7_ = REG_A >> 7;    \
+		RESOLVE_FLAGS();               \
+		REG_A = (REG_A << 1) | carry_; \
+		SET_CARRY(bit7_);              \
+		REG_PC += 1;                   \
+	} while (0)
+
+// Shift Accumultor to right, Bit0 will be transfered to carry, original carry
+// will be transfered to bit7
+#define OP_RAR(x, y)                          \
+	do {                                      \
+		uint8_t carry_ = GET_CARRY();         \
+		uint8_t bit0_ = REG_A & 1;            \
+		RESOLVE_FLAGS();                      \
+		REG_A = (REG_A >> 1) | (carry_ << 7); \
+		SET_CARRY(bit0_);                     \
+		REG_PC += 1;                          \
+	} while (0)
+
+// Add the content of BC,DE,HL or SP to HL
+#define OP_DAD(rp, y)                        \
+	do {                                     \
+		uint16_t value_ = REG16(rp);         \
+		RESOLVE_FLAGS();                     \
+		SET_CARRY(REG_HL + value_ > 0xFFFF); \
+		REG_HL += value_;                    \
+		REG_PC += 1;                         \
+	} while (0)
+
+// Store L in memory at address and H at address + 1
+#define OP_SHLD(x, y)                   \
+	do {                                \
+		uint16_t address_ = IMM16();    \
+		MEM_WRITE(address_, REG_L);     \
+		MEM_WRITE(address_ + 1, REG_H); \
+		REG_PC += 3;                    \
+	} while (0)
+
+// Load next 2 Bytes into HL
+#define OP_LHLD(x, y) (REG_HL = MEM_READ16(IMM16()), REG_PC += 3)
+
+// Store Accumulator at the given address
+#define OP_STA(x, y) (MEM_WRITE(IMM16(), REG_A), REG_PC += 3)
+
+// Load byte at the given address into Accumulator
+#define OP_LDA(x, y) (REG_A = MEM_READ(IMM16()), REG_PC += 3)
+
+/*
+	D A A (Decimal Adjust Accumulator)
+	The eight-bit number in the accumulator is adjusted
+	to form two four-bit Binary-Coded-Decimal digits by
+	the following process:
+	1. If the value of the least significant 4 bits of the
+	accumulator is greater than 9 or if the AC flag
+	is set, 6 is added to the accumulator.
+	2. If the value of the most significant 4 bits of the
+	accumulator is now greater than 9, or if the C Y
+	flag is set, 6 is added to the most significant 4
+	bits of the accumulator.
+*/
+#define OP_DAA(x, y)                                                       \
+	do {                                                                   \
+		uint8_t correction_ = 0;                                           \
+		RESOLVE_FLAGS();                                                   \
+		if (REG_F & AUXCARRY || (REG_A & 0x0F) > 9) {                      \
+			correction_ = 0x06;                                            \
+		}                                                                  \
+		if (REG_F & CARRY || REG_A > 0x99) {                               \
+			correction_ |= 0x60;                                           \
+			REG_F |= CARRY;                                                \
+		}                                                                  \
+		REG_F = (REG_F & ~(SIGN | ZERO | AUXCARRY | PARITY)) |             \
+				halfcarry_add_table[NIBBLE_INDEX(REG_A, correction_, 0)] | \
+				szp_table[(uint8_t)(REG_A + correction_)];                 \
+		REG_A += correction_;                                              \
+		REG_PC += 1;                                                       \
+	} while (0)
+
+// Complement the Accumulator
+#define OP_CMA(x, y) (REG_A = ~REG_A, REG_PC += 1)
+
+// Set Carry Flag
+#define OP_STC(x, y) (RESOLVE_FLAGS(), REG_F |= CARRY, REG_PC += 1)
+
+// XOR the Carry Bit
+#define OP_CMC(x, y) (RESOLVE_FLAGS(), REG_F ^= CARRY, REG_PC += 1)
+
+// Halt until an interrupt. PC stays on the HLT, so it is executed again
+// (and takes its cycles) until the interrupt is accepted.
+#define OP_HLT(x, y) (HALTED = 1)
+
+// Accepting an interrupt executes its RST without advancing PC, so it
+// returns to the interrupted instruction, or behind the HLT
+#define ACCEPT_INTERRUPT() (REG_PC += HALTED - 1, HALTED = 0)
+
+// Add content of Register to Accumulator
+#define OP_ADD(r, y)         \
+	do {                     \
+		ALU_ADD(GET8(r), 0); \
+		REG_PC += 1;         \
+	} while (0)
+// Add content of Register and carry-bit to Accumulator
+#define OP_ADC(r, y)                   \
+	do {                               \
+		ALU_ADD(GET8(r), GET_CARRY()); \
+		REG_PC += 1;                   \
+	} while (0)
+// Sub content of Register from Accumulator
+#define OP_SUB(r, y)         \
+	do {                     \
+		ALU_SUB(GET8(r), 0); \
+		REG_PC += 1;         \
+	} while (0)
+// Sub content of Register and carry from Accumulator
+#define OP_SBB(r, y)                   \
+	do {                               \
+		ALU_SUB(GET8(r), GET_CARRY()); \
+		REG_PC += 1;                   \
+	} while (0)
+// Bitwise AND Accumulator with content of register or memory
+#define OP_ANA(r, y)      \
+	do {                  \
+		ALU_ANA(GET8(r)); \
+		REG_PC += 1;      \
+	} while (0)
+// Bitwise XOR Accumulator with content of register or memory
+#define OP_XRA(r, y)            \
+	do {                        \
+		ALU_LOGIC(^=, GET8(r)); \
+		REG_PC += 1;            \
+	} while (0)
+// Bitwise OR Accumulator with content of register or memory
+#define OP_ORA(r, y)            \
+	do {                        \
+		ALU_LOGIC(|=, GET8(r)); \
+		REG_PC += 1;            \
+	} while (0)
+// Compare Accumulator to content of register or memory address
+#define OP_CMP(r, y)      \
+	do {                  \
+		ALU_CMP(GET8(r)); \
+		REG_PC += 1;      \
+	} while (0)
+
+// Add next Byte to Accumulator
+#define OP_ADI(x, y)        \
+	do {                    \
+		ALU_ADD(IMM8(), 0); \
+		REG_PC += 2;        \
+	} while (0)
+// Add next byte and carry to Accumulator
+#define OP_ACI(x, y)                  \
+	do {                              \
+		ALU_ADD(IMM8(), GET_CARRY()); \
+		REG_PC += 2;                  \
+	} while (0)
+// Subtract the next byte from Accumulator
+#define OP_SUI(x, y)        \
+	do {                    \
+		ALU_SUB(IMM8(), 0); \
+		REG_PC += 2;        \
+	} while (0)
+// Subtract the next byte and carry from Accumulator
+#define OP_SBI(x, y)                  \
+	do {                              \
+		ALU_SUB(IMM8(), GET_CARRY()); \
+		REG_PC += 2;                  \
+	} while (0)
+// Bitwise And Accumulator with next Byte
+#define OP_ANI(x, y)     \
+	do {                 \
+		ALU_ANA(IMM8()); \
+		REG_PC += 2;     \
+	} while (0)
+// Bitwise XOR Accumulator with next byte
+#define OP_XRI(x, y)           \
+	do {                       \
+		ALU_LOGIC(^=, IMM8()); \
+		REG_PC += 2;           \
+	} while (0)
+// Bitwise OR Accumulator with next Byte
+#define OP_ORI(x, y)           \
+	do {                       \
+		ALU_LOGIC(|=, IMM8()); \
+		REG_PC += 2;           \
+	} while (0)
+// Compare Accumulator to next byte
+#define OP_CPI(x, y)     \
+	do {                 \
+		ALU_CMP(IMM8()); \
+		REG_PC += 2;     \
+	} while (0)
+
+// Jump to address
+#define OP_JMP(x, y) (REG_PC = IMM16())
+
+// Load HL into PC
+#define OP_PCHL(x, y) (REG_PC = REG_HL)
+
+// Jump on Condition
+#define OP_JMPC(cc, y) (REG_PC = COND(cc) ? IMM16() : REG_PC + 3)
+
+// Call Subroutine, next 2 Bytes provide the address
+#define OP_CALL(x, y)                \
+	do {                             \
+		uint16_t address_ = IMM16(); \
+		PUSH16(REG_PC + 3);          \
+		REG_PC = address_;           \
+	} while (0)
+
+// Call Subroutine if Condition is true
+#define OP_CALLC(cc, y)    \
+	do {                   \
+		if (COND(cc)) {    \
+			OP_CALL(_, _); \
+			CYCLES += 6;   \
+		} else {           \
+			REG_PC += 3;   \
+		}                  \
+	} while (0)
+
+// Call Subroutine at n * 8 (see ACCEPT_INTERRUPT for the interrupt case)
+#define OP_RST(n, y)        \
+	do {                    \
+		PUSH16(REG_PC + 1); \
+		REG_PC = (n) * 8;   \
+	} while (0)
+
+// Return from Subroutine
+#define OP_RET(x, y) POP16(REG_PC = popped_)
+
+// Ret if Condition is true. Grouped Instructions
+#define OP_RETC(cc, y)    \
+	do {                  \
+		if (COND(cc)) {   \
+			OP_RET(_, _); \
+			CYCLES += 6;  \
+		} else {          \
+			REG_PC += 1;  \
+		}                 \
+	} while (0)
+
+// Push the contents of BC,DE,HL or AF to stack
+#define OP_PUSH(rp, y)     \
+	do {                   \
+		PUSH16(GET16(rp)); \
+		REG_PC += 1;       \
+	} while (0)
+
+// Pop(get back) register pair from stack
+#define OP_POP(rp, y)              \
+	do {                           \
+		POP16(SET16(rp, popped_)); \
+		REG_PC += 1;               \
+	} while (0)
+
+// Exchange the Low- and High Byte of the memory address stored in SP with HL
+#define OP_XTHL(x, y)                         \
+	do {                                      \
+		uint16_t value_ = MEM_READ16(REG_SP); \
+		MEM_WRITE(REG_SP, REG_L);             \
+		MEM_WRITE(REG_SP + 1, REG_H);         \
+		REG_HL = value_;                      \
+		REG_PC += 1;                          \
+	} while (0)
+
+// Load HL into SP
+#define OP_SPHL(x, y) (REG_SP = REG_HL, REG_PC += 1)
+
+// Exchange HL with DE
+#define OP_XCHG(x, y)            \
+	do {                         \
+		uint16_t temp_ = REG_HL; \
+		REG_HL = REG_DE;         \
+		REG_DE = temp_;          \
+		REG_PC += 1;             \
+	} while (0)
+
+// Disable Interrupts
+#define OP_DI(x, y) (INT_ENABLED = 0, REG_PC += 1)
+
+// Enable Interrupts
+#define OP_EI(x, y) (INT_ENABLED = 1, REG_PC += 1)
+
+// Read the input port given by the next byte into Accumulator
+#define OP_IN(x, y)                                            \
+	do {                                                       \
+		uint8_t port_ = IMM8();                                \
+		REG_A = port_ != 3 ? IO_PORT(port_ & 7) :              \
+							 getShiftRegister(SHIFT_REGISTER); \
+		REG_PC += 2;                                           \
+	} while (0)
+
+// Write Accumulator to the output port given by the next byte
+#define OP_OUT(x, y)                                                   \
+	do {                                                               \
+		uint8_t port_ = IMM8();                                        \
+		switch (port_) {                                               \
+		case 2:                                                        \
+			setShiftOffset(SHIFT_REGISTER, REG_A);                     \
+			break;                                                     \
+		case 4:                                                        \
+			setShiftRegister(SHIFT_REGISTER, REG_A);                   \
+			break;                                                     \
+		case 3: /* Sound */                                            \
+		case 5:                                                        \
+		case 6: /* Watchdog */                                         \
+			break;                                                     \
+		default:                                                       \
+			fprintf(stderr, "Unkown/Invalid port: %d (OUT)\n", port_); \
+			CRASH();                                                   \
+			break;                                                     \
+		}                                                              \
+		REG_PC += 2;                                                   \
+	} while (0)
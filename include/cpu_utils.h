@@ -1,5 +0,0 @@
-#pragma once
-#include "cpu.h"
-
-uint8_t *get_reg8(cpu_t *cpu, int n);
-uint16_t *get_reg16(cpu_t *cpu, int n);
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+
+#include "cpu.h"
+
+// Optional x86-64 recompiler (Linux only, build with -DDYNAREC=ON).
+//
+// Basic blocks in the ROM are translated into native code that works on the
+// cpu_t fields directly, simple instructions are emitted inline, everything
+// else calls the interpreter's opcode handler. Blocks with a known successor
+// jump straight into it once that block exists. Code outside the ROM, pending
+// interrupts and the last instructions before the cycle budget runs out are
+// left to step(), so the result is the same as with the interpreter.
+//
+// Every machine has its own translator (see machine.h), the blocks are
+// thrown away when the machine loads a different ROM.
+typedef struct dynarec dynarec_t;
+
+// Allocate the code buffer, returns NULL if that failed
+dynarec_t *createDynarec(void);
+
+void destroyDynarec(dynarec_t *dynarec);
+
+// Same as step_cycles(), but runs the ROM through the recompiled blocks
+uint32_t runDynarec(dynarec_t *dynarec, cpu_t *cpu, uint32_t budget);
@@ -26,17 +26,189 @@ enum FLAGS {
 	SIGN = 0x80
 };
 
+// All flags that are changed by the arithmetic and logical instructions
+#define FLAGS_ALL (SIGN | ZERO | AUXCARRY | PARITY | CARRY)
+
+// Sign, Zero and Parity flag of every 8-Bit value
+extern const uint8_t szp_table[256];
+
+// Auxiliary Carry flag of an addition/subtraction of two nibbles and a
+// carry-in, index: carry << 8 | (byte1 & 0x0F) << 4 | (byte2 & 0x0F)
+extern const uint8_t halfcarry_add_table[512];
+extern const uint8_t halfcarry_sub_table[512];
+
+#define NIBBLE_INDEX(byte1, byte2, carry) \
+	((carry) << 8 | ((byte1) & 0x0F) << 4 | ((byte2) & 0x0F))
+
+// Auxiliary Carry flag of ANA and ANI, the OR of bit 3 of the operands
+#define ANA_AUXCARRY(byte1, byte2) (((byte1) | (byte2)) & 0x08 ? AUXCARRY : 0)
+
+// Flags after result = byte1 + byte2 + carry
+static inline uint8_t flags_add8(uint8_t byte1, uint8_t byte2, uint8_t carry,
+								 uint8_t result)
+{
+	return szp_table[result] |
+		   halfcarry_add_table[NIBBLE_INDEX(byte1, byte2, carry)] |
+		   (byte1 + byte2 + carry > 0xFF ? CARRY : 0);
+}
+
+// Flags after result = byte1 - byte2 - carry
+static inline uint8_t flags_sub8(uint8_t byte1, uint8_t byte2, uint8_t carry,
+								 uint8_t result)
+{
+	return szp_table[result] |
+		   halfcarry_sub_table[NIBBLE_INDEX(byte1, byte2, carry)] |
+		   (byte1 < byte2 + carry ? CARRY : 0);
+}
+
+// Replace the flags selected by mask with the given flags in one store
+static inline void update_flags(cpu_t *cpu, uint8_t mask, uint8_t flags)
+{
+	cpu->AF.lowByte = (cpu->AF.lowByte & ~mask) | flags;
+}
+
+#ifdef LAZY_FLAGS_VALIDATE
+// Compute the flags of a lazy operation with the handle_* functions
+uint8_t eager_flags(uint8_t flags, const lazy_flags_t *lazy);
+#endif
+
+// Compute the flags described by the lazy record (only FLAGS_ALL bits)
+static inline uint8_t lazy_flags_value(const lazy_flags_t *lazy)
+{
+	switch (lazy->op) {
+	case LAZY_ADD:
+		return flags_add8(lazy->byte1, lazy->byte2, lazy->carry, lazy->result);
+	case LAZY_SUB:
+		return flags_sub8(lazy->byte1, lazy->byte2, lazy->carry, lazy->result);
+	case LAZY_INR:
+		return szp_table[lazy->result] | lazy->carry |
+			   halfcarry_add_table[NIBBLE_INDEX(lazy->byte1, 1, 0)];
+	case LAZY_DCR:
+		return szp_table[lazy->result] | lazy->carry |
+			   halfcarry_sub_table[NIBBLE_INDEX(lazy->byte1, 1, 0)];
+	case LAZY_ANA:
+		return szp_table[lazy->result] |
+			   ANA_AUXCARRY(lazy->byte1, lazy->byte2);
+	default: // LAZY_LOGIC
+		return szp_table[lazy->result];
+	}
+}
+
+// The helpers below work on a plain F value and lazy record, so that code
+// keeping the registers in locals (see step_cycles) can use them as well
+
+// Return the current flags
+static inline uint8_t lazy_get_flags(uint8_t f, const lazy_flags_t *lazy)
+{
+	if (lazy->op == LAZY_NONE) {
+		return f;
+	}
+
+	return (f & ~FLAGS_ALL) | lazy_flags_value(lazy);
+}
+
+// Return only the Carry flag (0 or 1)
+static inline uint8_t lazy_get_carry(uint8_t f, const lazy_flags_t *lazy)
+{
+	switch (lazy->op) {
+	case LAZY_NONE:
+		return f & CARRY;
+	case LAZY_ADD:
+		return lazy->byte1 + lazy->byte2 + lazy->carry > 0xFF;
+	case LAZY_SUB:
+		return lazy->byte1 < lazy->byte2 + lazy->carry;
+	case LAZY_INR:
+	case LAZY_DCR:
+		return lazy->carry;
+	default: // Logical instructions clear the carry
+		return 0;
+	}
+}
+
+// Return a single flag (non-zero if set) without computing the others
+static inline uint8_t lazy_get_flag(uint8_t f, const lazy_flags_t *lazy,
+									enum FLAGS flag)
+{
+	if (lazy->op == LAZY_NONE) {
+		return f & flag;
+	}
+
+	switch (flag) {
+	case CARRY:
+		return lazy_get_carry(f, lazy);
+	case AUXCARRY:
+		return lazy_flags_value(lazy) & AUXCARRY;
+	default: // Sign, Zero and Parity only depend on the result
+		return szp_table[lazy->result] & flag;
+	}
+}
+
+// Remember an ALU operation, carry is the carry-in of ADD and SUB (ADC and
+// SBB). INR and DCR keep the previous Carry instead.
+static inline void lazy_record(lazy_flags_t *lazy, uint8_t f, enum LAZY_OP op,
+							   uint8_t byte1, uint8_t byte2, uint8_t carry,
+							   uint8_t result)
+{
+	lazy->carry = op == LAZY_INR || op == LAZY_DCR ?
+					  lazy_get_carry(f, lazy) :
+					  carry;
+	lazy->op = op;
+	lazy->byte1 = byte1;
+	lazy->byte2 = byte2;
+	lazy->result = result;
+}
+
+// Return the current flags without changing the CPU state
+static inline uint8_t get_flags(const cpu_t *cpu)
+{
+	return lazy_get_flags(cpu->AF.lowByte, &cpu->lazy);
+}
+
+// Return only the Carry flag (0 or 1)
+static inline uint8_t get_carry(const cpu_t *cpu)
+{
+	return lazy_get_carry(cpu->AF.lowByte, &cpu->lazy);
+}
+
+// Return a single flag (non-zero if set) without computing the others
+static inline uint8_t get_flag(const cpu_t *cpu, enum FLAGS flag)
+{
+	return lazy_get_flag(cpu->AF.lowByte, &cpu->lazy, flag);
+}
+
+// Write the pending flags into F, has to be called before F is accessed
+// directly
+static inline void resolve_flags(cpu_t *cpu)
+{
+	cpu->AF.lowByte = get_flags(cpu);
+	cpu->lazy.op = LAZY_NONE;
+}
+
+// Remember an ALU operation, the flags are computed once they are needed
+static inline void set_lazy_flags(cpu_t *cpu, enum LAZY_OP op, uint8_t byte1,
+								  uint8_t byte2, uint8_t carry, uint8_t result)
+{
+#ifdef LAZY_FLAGS_VALIDATE
+	lazy_flags_t eager = { op, byte1, byte2, result,
+						   op == LAZY_INR || op == LAZY_DCR ? get_carry(cpu) :
+															  carry };
+	cpu->eager_flags = eager_flags(get_flags(cpu), &eager);
+#endif
+
+	lazy_record(&cpu->lazy, cpu->AF.lowByte, op, byte1, byte2, carry, result);
+}
+
 void handle_zero(cpu_t *cpu, uint8_t value);
 void handle_parity(cpu_t *cpu, uint8_t byte);
 void handle_sign(cpu_t *cpu, uint8_t byte);
 
-void handle_carry8(cpu_t *cpu, uint8_t byte1, uint8_t byte2,
+void handle_carry8(cpu_t *cpu, uint8_t byte1, uint8_t byte2, uint8_t carry,
 				   uint8_t isSubtraction);
 void handle_carry16(cpu_t *cpu, uint16_t word1, uint16_t word2,
 					uint8_t isSubtraction);
 
 void handle_halfcarry8(cpu_t *cpu, uint8_t byte1, uint8_t byte2,
-					   uint8_t isSubtraction);
+					   uint8_t carry, uint8_t isSubtraction);
 
 // void handle_halfcarry16(cpu_t *cpu, uint16_t word1, uint16_t word2,
 // uint8_t isSubtraction);
@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+
+#include "machine.h"
+
+/*
+ *  Golden traces: the hash of the RAM and the VRAM after every frame of a
+ *  headless run. Recording one with a known good build and verifying later
+ *  builds against it (with the same inputs, e.g. a movie) finds the first
+ *  frame in which the emulation differs.
+ *
+ *  File layout (host byte order):
+ *
+ *      frame_hashes_header_t
+ *      uint64_t hashes[frames]
+ */
+
+#define FRAME_HASHES_MAGIC 0x48564953 // "SIVH"
+#define FRAME_HASHES_VERSION 1
+
+typedef struct frame_hashes_header {
+	uint32_t magic; // FRAME_HASHES_MAGIC
+	uint16_t version; // FRAME_HASHES_VERSION
+	uint16_t reserved; // Always 0
+	uint64_t romHash; // rom_cache_t.hash of the ROM that was run
+	uint64_t frames;
+} frame_hashes_header_t;
+
+_Static_assert(sizeof(frame_hashes_header_t) == 24,
+			   "frame_hashes_header_t must not be padded");
+
+typedef struct frame_hashes {
+	uint64_t *hashes;
+	uint64_t count; // Recorded or loaded hashes
+	uint64_t capacity;
+	uint64_t frame; // Frames checked so far
+	uint8_t verify; // Compare against the loaded hashes instead of recording
+	uint8_t diverged;
+	uint64_t firstDivergence; // Frame index, valid if diverged is set
+} frame_hashes_t;
+
+// Hash of the RAM and the VRAM of the machine
+uint64_t hashFrame(const machine_t *machine);
+
+// Start an empty trace to record
+void initFrameHashes(frame_hashes_t *trace);
+
+// Load the trace at path to verify against, exits if it is invalid or was
+// recorded with a different ROM than the one of the machine
+void loadFrameHashes(frame_hashes_t *trace, const machine_t *machine,
+					 const char *path);
+
+// Record or verify the hash of the frame that was just run
+void checkFrameHash(frame_hashes_t *trace, const machine_t *machine);
+
+// Returns 1 if every loaded hash was checked and matched
+uint8_t frameHashesMatch(const frame_hashes_t *trace);
+
+// Write the recorded trace to the file at path, returns 0 on failure
+uint8_t saveFrameHashes(const frame_hashes_t *trace, const machine_t *machine,
+						const char *path);
+
+void freeFrameHashes(frame_hashes_t *trace);
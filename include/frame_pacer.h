@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+
+#include "scheduler.h"
+
+/*
+ *  Paces the interactive mode to the emulated frames: one frame period is
+ *  the time CYCLES_PER_FRAME take at CPU_CLOCK, so the game runs at the
+ *  speed of the emulated 8080.
+ *
+ *  Every frame has an absolute deadline, one frame period after the one
+ *  before, so the time lost to a late frame is made up by the next ones
+ *  instead of adding up. The pacer sleeps with clock_nanosleep() until
+ *  shortly before the deadline and spins for the rest, as the sleep can
+ *  end late on a loaded host. How long it spins follows how late the
+ *  sleeps woke up. If the host falls more than a whole frame behind (a
+ *  stall, a window being dragged) the deadlines start over from now,
+ *  otherwise the frames after it would run as fast as possible.
+ *
+ *  The frame times and how late the frames ended (the jitter) are kept in
+ *  histograms of 1 us, for the percentiles printed on exit.
+ */
+
+// Frame period in ns is FRAME_NS_NUMERATOR / FRAME_NS_DENOMINATOR
+#define FRAME_NS_NUMERATOR (1000000000ULL * CYCLES_PER_FRAME)
+#define FRAME_NS_DENOMINATOR CPU_CLOCK
+
+// Longer times are counted in the last bucket of the histograms
+#define PACER_HISTOGRAM_US 100000
+
+typedef struct frame_pacer {
+	uint64_t deadline; // End of the current frame (see getTimeNS())
+	uint64_t remainder; // Of the deadline, in 1/FRAME_NS_DENOMINATOR ns
+	uint64_t lastFrame; // When the last frame ended
+	uint64_t spinNS; // Time before the deadline that is not slept
+	// Statistics
+	uint32_t *frameTimes; // Histogram of the frame times
+	uint32_t *jitter; // Histogram of the time past the deadlines
+	uint64_t maxFrameNS;
+	uint64_t maxJitterNS;
+	uint64_t frames;
+	uint64_t late; // Frames that took longer than their period
+	uint64_t resyncs; // The deadlines started over
+} frame_pacer_t;
+
+// Start pacing, the first frame ends one period from now. Exits if the
+// histograms can't be allocated.
+void initFramePacer(frame_pacer_t *pacer);
+
+// Wait for the end of the current frame and start the next one
+void waitForFrame(frame_pacer_t *pacer);
+
+// Print the frame time and jitter percentiles (p50/p99/max)
+void printFramePacerStats(const frame_pacer_t *pacer);
+
+void freeFramePacer(frame_pacer_t *pacer);
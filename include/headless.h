@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+#include "frame_hashes.h"
+#include "machine.h"
+#include "movie.h"
+
+typedef struct headless_config {
+	uint64_t frames; // Number of frames to emulate
+	uint64_t cycles; // Number of cycles to emulate (0 -> use frames instead)
+	uint8_t rewind; // Record the rewind history and print what it costs
+	uint32_t runAhead; // Frames to run ahead (see runahead.h), 0 -> off
+	movie_t *movie; // Replay its inputs instead of using frames and cycles
+	frame_hashes_t *hashes; // Record or verify the hash of every frame
+} headless_config_t;
+
+// Same frame layout as emulate_frame() in main.c, but without drawing and
+// without waiting for the next frame. Returns the cycles it took.
+uint32_t emulateFrameHeadless(cpu_t *cpu);
+
+// Run the emulator without SDL as fast as possible and print the throughput.
+// Returns 0 if the frames did not match config->hashes.
+uint8_t runHeadless(machine_t *machine, const headless_config_t *config);
@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+// Monotonic host time in ns (needs _POSIX_C_SOURCE >= 199309L)
+static inline uint64_t getTimeNS(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
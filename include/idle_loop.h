@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ *  Idle loops wait for an interrupt handler to change a variable in RAM,
+ *  e.g. in Space Invaders:
+ *
+ *      0ADA LDA $20C0
+ *      0ADD ANA A
+ *      0ADE JNZ $0ADA
+ *
+ *  The body of such a loop has no side effects: it only reads memory and
+ *  registers it doesn't change, and doesn't branch other than the jump
+ *  back. Until the next interrupt every iteration does the same, so
+ *  step_cycles() skips as many iterations as fit into its budget at once,
+ *  right after the jump back. It ends on the same instruction with the
+ *  same cycles as without skipping, so the emulation is not changed.
+ *
+ *  The idle loops of a ROM are found when it is decoded (see rom_cache.h).
+ *  Only the interpreter skips: the profile and trace builds record every
+ *  instruction, and the AOT and dynarec code runs them natively.
+ */
+
+#define IDLE_LOOPS_MAX 16
+#define IDLE_LOOP_MAX_LENGTH 16 // Bytes from the start to the jump back
+
+typedef struct idle_loop {
+	uint16_t start; // Target of the jump back
+	uint16_t jump; // The conditional jump back
+	uint8_t cycles; // Of one iteration
+	uint8_t instructions; // Of one iteration
+} idle_loop_t;
+
+// Skipping of one machine
+typedef struct idle_skip {
+	uint8_t enabled;
+	uint64_t hits[IDLE_LOOPS_MAX]; // Skips per loop
+	uint64_t cycles; // Cycles skipped in total
+} idle_skip_t;
+
+// Find the idle loops in the ROM (ROM_SIZE bytes), returns how many were
+// stored in loops (at most IDLE_LOOPS_MAX)
+uint8_t findIdleLoops(const uint8_t *rom, idle_loop_t *loops);
+
+// Enable skipping and clear the counters
+void initIdleSkip(idle_skip_t *skip);
@@ -1,5 +1,8 @@
 #pragma once
 
-#include "cpu.h"
+#include "machine.h"
 
-void handle_events(cpu_t *cpu, uint8_t *running);
+void handle_events(machine_t *machine, uint8_t *running);
+
+// Frames to go back per frame while the rewind key is held, 0 if it isn't
+uint8_t getRewindSpeed(void);
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+
+#include "bus.h"
+#include "cpu.h"
+#include "dynarec.h"
+#include "idle_loop.h"
+#include "profile.h"
+#include "scheduler.h"
+#include "shift_register.h"
+#include "trace.h"
+
+/*
+ *  Everything one Space Invaders board consists of. Nothing in the emulator
+ *  core is global, so any number of machines can run at the same time, each
+ *  one on its own thread.
+ *
+ *  I/O ports:
+ *
+ *  IN  0 unused by the game, 1 player 1 / coins, 2 player 2 / DIP switches,
+ *      3 shift register result
+ *  OUT 2 shift offset, 3 sound, 4 shift data, 5 sound, 6 watchdog
+ */
+typedef struct machine {
+	cpu_t cpu;
+	memory_t memory;
+	bus_t bus;
+	shift_register_t shiftRegister;
+	uint8_t io_port[0x8]; // Input ports
+	scheduler_t scheduler; // The interrupts of the screen
+	idle_skip_t idleSkip; // See idle_loop.h
+#ifdef CPU_DYNAREC
+	dynarec_t *dynarec; // NULL if the code buffer couldn't be allocated
+#endif
+#ifdef CPU_PROFILE
+	profile_t *profile;
+#endif
+#ifdef CPU_TRACE
+	trace_t *trace;
+#endif
+} machine_t;
+
+// Reset the CPU, clear the memory and connect everything
+void initMachine(machine_t *machine);
+
+// Run the CPU until the next event is due, handle it and return its type
+// (enum EVENT). A frame ends with EVENT_VBLANK.
+uint8_t runUntilEvent(machine_t *machine);
+
+// Free what initMachine() allocated
+void freeMachine(machine_t *machine);
+
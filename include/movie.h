@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+#include "machine.h"
+#include "savestate.h"
+
+/*
+ *  Input movies make a session reproducible. The game only sees the host
+ *  through the input ports 1 and 2, so the state of the machine when the
+ *  recording started plus the values of both ports in every frame are
+ *  enough to replay it exactly.
+ *
+ *  File layout (host byte order like the save states):
+ *
+ *      movie_header_t    with the initial state (and with it the ROM hash)
+ *      movie_run_t[runs] the port values, run length encoded
+ *
+ *  The ports only change when a key is pressed or released, so an hour of
+ *  play is a few thousand runs.
+ */
+
+#define MOVIE_MAGIC 0x4D564953 // "SIVM"
+#define MOVIE_VERSION 2
+
+typedef struct movie_run {
+	uint16_t length; // Frames the ports keep these values, at least 1
+	uint8_t port1;
+	uint8_t port2;
+} movie_run_t;
+
+typedef struct movie_header {
+	uint32_t magic; // MOVIE_MAGIC
+	uint16_t version; // MOVIE_VERSION
+	uint16_t reserved; // Always 0
+	uint32_t frames; // Sum of the run lengths
+	uint32_t runs;
+	savestate_t initial; // State before the first frame
+} movie_header_t;
+
+_Static_assert(sizeof(movie_run_t) == 4, "movie_run_t must not be padded");
+_Static_assert(sizeof(movie_header_t) == 16 + sizeof(savestate_t),
+			   "movie_header_t must not be padded");
+
+typedef struct movie {
+	movie_header_t header;
+	FILE *file; // Recording only
+	movie_run_t *runs; // Replay only
+	movie_run_t current; // The run being recorded or played
+	uint32_t nextRun; // Replay only
+} movie_t;
+
+// Create the movie at path, starting with the current state of the machine
+void startRecording(movie_t *movie, const machine_t *machine,
+					const char *path);
+
+// Append the input ports of the machine, once per frame before it is run
+void recordInput(movie_t *movie, const machine_t *machine);
+
+// Write the last run and the final header, closes the file
+void stopRecording(movie_t *movie);
+
+// Read the movie at path and restore its initial state into the machine,
+// which has to have the ROM of the movie loaded already
+void loadMovie(movie_t *movie, machine_t *machine, const char *path);
+
+// Set the input ports of the machine for the next frame, returns 0 once
+// every recorded frame was played
+uint8_t playInput(movie_t *movie, machine_t *machine);
+
+void freeMovie(movie_t *movie);
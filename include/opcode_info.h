@@ -0,0 +1,125 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ *  opcodes.h as data, for the code that looks at instructions instead of
+ *  executing them: the dynarec, the idle loop detection, the profiler and
+ *  the tools. The instructions and operands are enums built from the names
+ *  in opcodes.h, so renaming one there breaks the build here instead of
+ *  silently changing what the string comparisons match.
+ */
+
+// One per instruction name in opcodes.h
+enum INSTRUCTION {
+	INSTR_ACI,
+	INSTR_ADC,
+	INSTR_ADD,
+	INSTR_ADI,
+	INSTR_ANA,
+	INSTR_ANI,
+	INSTR_CALL,
+	INSTR_CALLC,
+	INSTR_CMA,
+	INSTR_CMC,
+	INSTR_CMP,
+	INSTR_CPI,
+	INSTR_DAA,
+	INSTR_DAD,
+	INSTR_DCR,
+	INSTR_DCX,
+	INSTR_DI,
+	INSTR_EI,
+	INSTR_HLT,
+	INSTR_IN,
+	INSTR_INR,
+	INSTR_INX,
+	INSTR_JMP,
+	INSTR_JMPC,
+	INSTR_LDA,
+	INSTR_LDAX,
+	INSTR_LHLD,
+	INSTR_LXI,
+	INSTR_MOV,
+	INSTR_MVI,
+	INSTR_NOP,
+	INSTR_ORA,
+	INSTR_ORI,
+	INSTR_OUT,
+	INSTR_PCHL,
+	INSTR_POP,
+	INSTR_PUSH,
+	INSTR_RAL,
+	INSTR_RAR,
+	INSTR_RET,
+	INSTR_RETC,
+	INSTR_RLC,
+	INSTR_RRC,
+	INSTR_RST,
+	INSTR_SBB,
+	INSTR_SBI,
+	INSTR_SHLD,
+	INSTR_SPHL,
+	INSTR_STA,
+	INSTR_STAX,
+	INSTR_STC,
+	INSTR_SUB,
+	INSTR_SUI,
+	INSTR_XCHG,
+	INSTR_XRA,
+	INSTR_XRI,
+	INSTR_XTHL
+};
+
+// The operands of opcodes.h. C and M are also the conditions Carry and
+// Minus, the number of a RST is OPERAND_0 ... OPERAND_7.
+enum OPERAND {
+	OPERAND__, // None ("_")
+	OPERAND_A,
+	OPERAND_B,
+	OPERAND_C,
+	OPERAND_D,
+	OPERAND_E,
+	OPERAND_H,
+	OPERAND_L,
+	OPERAND_M, // The memory at HL
+	OPERAND_BC,
+	OPERAND_DE,
+	OPERAND_HL,
+	OPERAND_SP,
+	OPERAND_PSW,
+	OPERAND_NZ,
+	OPERAND_Z,
+	OPERAND_NC,
+	OPERAND_PO,
+	OPERAND_PE,
+	OPERAND_P,
+	OPERAND_0,
+	OPERAND_1,
+	OPERAND_2,
+	OPERAND_3,
+	OPERAND_4,
+	OPERAND_5,
+	OPERAND_6,
+	OPERAND_7
+};
+
+typedef struct opcode_info {
+	uint8_t instruction; // enum INSTRUCTION
+	uint8_t x; // enum OPERAND
+	uint8_t y;
+	uint8_t length; // In bytes, including the opcode
+	uint8_t cycles; // See opcodes.h
+	// The names in opcodes.h, "_" for no operand
+	const char *name;
+	const char *xName;
+	const char *yName;
+} opcode_info_t;
+
+extern const opcode_info_t opcodeInfo[256];
+
+// JMPC, CALLC and RETC
+static inline uint8_t isConditional(uint8_t instruction)
+{
+	return instruction == INSTR_JMPC || instruction == INSTR_CALLC ||
+		   instruction == INSTR_RETC;
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+// Intel 8080 opcode table, one entry per opcode:
+//
+//	X(opcode, instruction, operand1, operand2, length, cycles)
+//
+// Operands are registers (B C D E H L M A), register pairs (BC DE HL SP PSW),
+// conditions (NZ Z NC C PO PE P M) or the RST number, unused ones are "_".
+// The length is in bytes including the opcode.
+// Conditional calls and returns list the cycles for the not taken case, the
+// instruction adds the rest if the condition is true. Conditional jumps take
+// 10 cycles either way.
+//
+// Include this where the instructions are expanded, e.g.
+//
+//	#define X(code, op, x, y, length, cycles) case code: OP_##op(x, y); ...
+//	OPCODE_TABLE(X)
+#define OPCODE_TABLE(X)          \
+	X(0x00, NOP, _, _, 1, 4)     \
+	X(0x01, LXI, BC, _, 3, 10)   \
+	X(0x02, STAX, BC, _, 1, 7)   \
+	X(0x03, INX, BC, _, 1, 5)    \
+	X(0x04, INR, B, _, 1, 5)     \
+	X(0x05, DCR, B, _, 1, 5)     \
+	X(0x06, MVI, B, _, 2, 7)     \
+	X(0x07, RLC, _, _, 1, 4)     \
+	X(0x08, NOP, _, _, 1, 4)     \
+	X(0x09, DAD, BC, _, 1, 10)   \
+	X(0x0A, LDAX, BC, _, 1, 7)   \
+	X(0x0B, DCX, BC, _, 1, 5)    \
+	X(0x0C, INR, C, _, 1, 5)     \
+	X(0x0D, DCR, C, _, 1, 5)     \
+	X(0x0E, MVI, C, _, 2, 7)     \
+	X(0x0F, RRC, _, _, 1, 4)     \
+	X(0x10, NOP, _, _, 1, 4)     \
+	X(0x11, LXI, DE, _, 3, 10)   \
+	X(0x12, STAX, DE, _, 1, 7)   \
+	X(0x13, INX, DE, _, 1, 5)    \
+	X(0x14, INR, D, _, 1, 5)     \
+	X(0x15, DCR, D, _, 1, 5)     \
+	X(0x16, MVI, D, _, 2, 7)     \
+	X(0x17, RAL, _, _, 1, 4)     \
+	X(0x18, NOP, _, _, 1, 4)     \
+	X(0x19, DAD, DE, _, 1, 10)   \
+	X(0x1A, LDAX, DE, _, 1, 7)   \
+	X(0x1B, DCX, DE, _, 1, 5)    \
+	X(0x1C, INR, E, _, 1, 5)     \
+	X(0x1D, DCR, E, _, 1, 5)     \
+	X(0x1E, MVI, E, _, 2, 7)     \
+	X(0x1F, RAR, _, _, 1, 4)     \
+	X(0x20, NOP, _, _, 1, 4)     \
+	X(0x21, LXI, HL, _, 3, 10)   \
+	X(0x22, SHLD, _, _, 3, 16)   \
+	X(0x23, INX, HL, _, 1, 5)    \
+	X(0x24, INR, H, _, 1, 5)     \
+	X(0x25, DCR, H, _, 1, 5)     \
+	X(0x26, MVI, H, _, 2, 7)     \
+	X(0x27, DAA, _, _, 1, 4)     \
+	X(0x28, NOP, _, _, 1, 4)     \
+	X(0x29, DAD, HL, _, 1, 10)   \
+	X(0x2A, LHLD, _, _, 3, 16)   \
+	X(0x2B, DCX, HL, _, 1, 5)    \
+	X(0x2C, INR, L, _, 1, 5)     \
+	X(0x2D, DCR, L, _, 1, 5)     \
+	X(0x2E, MVI, L, _, 2, 7)     \
+	X(0x2F, CMA, _, _, 1, 4)     \
+	X(0x30, NOP, _, _, 1, 4)     \
+	X(0x31, LXI, SP, _, 3, 10)   \
+	X(0x32, STA, _, _, 3, 13)    \
+	X(0x33, INX, SP, _, 1, 5)    \
+	X(0x34, INR, M, _, 1, 10)    \
+	X(0x35, DCR, M, _, 1, 10)    \
+	X(0x36, MVI, M, _, 2, 10)    \
+	X(0x37, STC, _, _, 1, 4)     \
+	X(0x38, NOP, _, _, 1, 4)     \
+	X(0x39, DAD, SP, _, 1, 10)   \
+	X(0x3A, LDA, _, _, 3, 13)    \
+	X(0x3B, DCX, SP, _, 1, 5)    \
+	X(0x3C, INR, A, _, 1, 5)     \
+	X(0x3D, DCR, A, _, 1, 5)     \
+	X(0x3E, MVI, A, _, 2, 7)     \
+	X(0x3F, CMC, _, _, 1, 4)     \
+	X(0x40, MOV, B, B, 1, 5)     \
+	X(0x41, MOV, B, C, 1, 5)     \
+	X(0x42, MOV, B, D, 1, 5)     \
+	X(0x43, MOV, B, E, 1, 5)     \
+	X(0x44, MOV, B, H, 1, 5)     \
+	X(0x45, MOV, B, L, 1, 5)     \
+	X(0x46, MOV, B, M, 1, 7)     \
+	X(0x47, MOV, B, A, 1, 5)     \
+	X(0x48, MOV, C, B, 1, 5)     \
+	X(0x49, MOV, C, C, 1, 5)     \
+	X(0x4A, MOV, C, D, 1, 5)     \
+	X(0x4B, MOV, C, E, 1, 5)     \
+	X(0x4C, MOV, C, H, 1, 5)     \
+	X(0x4D, MOV, C, L, 1, 5)     \
+	X(0x4E, MOV, C, M, 1, 7)     \
+	X(0x4F, MOV, C, A, 1, 5)     \
+	X(0x50, MOV, D, B, 1, 5)     \
+	X(0x51, MOV, D, C, 1, 5)     \
+	X(0x52, MOV, D, D, 1, 5)     \
+	X(0x53, MOV, D, E, 1, 5)     \
+	X(0x54, MOV, D, H, 1, 5)     \
+	X(0x55, MOV, D, L, 1, 5)     \
+	X(0x56, MOV, D, M, 1, 7)     \
+	X(0x57, MOV, D, A, 1, 5)     \
+	X(0x58, MOV, E, B, 1, 5)     \
+	X(0x59, MOV, E, C, 1, 5)     \
+	X(0x5A, MOV, E, D, 1, 5)     \
+	X(0x5B, MOV, E, E, 1, 5)     \
+	X(0x5C, MOV, E, H, 1, 5)     \
+	X(0x5D, MOV, E, L, 1, 5)     \
+	X(0x5E, MOV, E, M, 1, 7)     \
+	X(0x5F, MOV, E, A, 1, 5)     \
+	X(0x60, MOV, H, B, 1, 5)     \
+	X(0x61, MOV, H, C, 1, 5)     \
+	X(0x62, MOV, H, D, 1, 5)     \
+	X(0x63, MOV, H, E, 1, 5)     \
+	X(0x64, MOV, H, H, 1, 5)     \
+	X(0x65, MOV, H, L, 1, 5)     \
+	X(0x66, MOV, H, M, 1, 7)     \
+	X(0x67, MOV, H, A, 1, 5)     \
+	X(0x68, MOV, L, B, 1, 5)     \
+	X(0x69, MOV, L, C, 1, 5)     \
+	X(0x6A, MOV, L, D, 1, 5)     \
+	X(0x6B, MOV, L, E, 1, 5)     \
+	X(0x6C, MOV, L, H, 1, 5)     \
+	X(0x6D, MOV, L, L, 1, 5)     \
+	X(0x6E, MOV, L, M, 1, 7)     \
+	X(0x6F, MOV, L, A, 1, 5)     \
+	X(0x70, MOV, M, B, 1, 7)     \
+	X(0x71, MOV, M, C, 1, 7)     \
+	X(0x72, MOV, M, D, 1, 7)     \
+	X(0x73, MOV, M, E, 1, 7)     \
+	X(0x74, MOV, M, H, 1, 7)     \
+	X(0x75, MOV, M, L, 1, 7)     \
+	X(0x76, HLT, _, _, 1, 7)     \
+	X(0x77, MOV, M, A, 1, 7)     \
+	X(0x78, MOV, A, B, 1, 5)     \
+	X(0x79, MOV, A, C, 1, 5)     \
+	X(0x7A, MOV, A, D, 1, 5)     \
+	X(0x7B, MOV, A, E, 1, 5)     \
+	X(0x7C, MOV, A, H, 1, 5)     \
+	X(0x7D, MOV, A, L, 1, 5)     \
+	X(0x7E, MOV, A, M, 1, 7)     \
+	X(0x7F, MOV, A, A, 1, 5)     \
+	X(0x80, ADD, B, _, 1, 4)     \
+	X(0x81, ADD, C, _, 1, 4)     \
+	X(0x82, ADD, D, _, 1, 4)     \
+	X(0x83, ADD, E, _, 1, 4)     \
+	X(0x84, ADD, H, _, 1, 4)     \
+	X(0x85, ADD, L, _, 1, 4)     \
+	X(0x86, ADD, M, _, 1, 7)     \
+	X(0x87, ADD, A, _, 1, 4)     \
+	X(0x88, ADC, B, _, 1, 4)     \
+	X(0x89, ADC, C, _, 1, 4)     \
+	X(0x8A, ADC, D, _, 1, 4)     \
+	X(0x8B, ADC, E, _, 1, 4)     \
+	X(0x8C, ADC, H, _, 1, 4)     \
+	X(0x8D, ADC, L, _, 1, 4)     \
+	X(0x8E, ADC, M, _, 1, 7)     \
+	X(0x8F, ADC, A, _, 1, 4)     \
+	X(0x90, SUB, B, _, 1, 4)     \
+	X(0x91, SUB, C, _, 1, 4)     \
+	X(0x92, SUB, D, _, 1, 4)     \
+	X(0x93, SUB, E, _, 1, 4)     \
+	X(0x94, SUB, H, _, 1, 4)     \
+	X(0x95, SUB, L, _, 1, 4)     \
+	X(0x96, SUB, M, _, 1, 7)     \
+	X(0x97, SUB, A, _, 1, 4)     \
+	X(0x98, SBB, B, _, 1, 4)     \
+	X(0x99, SBB, C, _, 1, 4)     \
+	X(0x9A, SBB, D, _, 1, 4)     \
+	X(0x9B, SBB, E, _, 1, 4)     \
+	X(0x9C, SBB, H, _, 1, 4)     \
+	X(0x9D, SBB, L, _, 1, 4)     \
+	X(0x9E, SBB, M, _, 1, 7)     \
+	X(0x9F, SBB, A, _, 1, 4)     \
+	X(0xA0, ANA, B, _, 1, 4)     \
+	X(0xA1, ANA, C, _, 1, 4)     \
+	X(0xA2, ANA, D, _, 1, 4)     \
+	X(0xA3, ANA, E, _, 1, 4)     \
+	X(0xA4, ANA, H, _, 1, 4)     \
+	X(0xA5, ANA, L, _, 1, 4)     \
+	X(0xA6, ANA, M, _, 1, 7)     \
+	X(0xA7, ANA, A, _, 1, 4)     \
+	X(0xA8, XRA, B, _, 1, 4)     \
+	X(0xA9, XRA, C, _, 1, 4)     \
+	X(0xAA, XRA, D, _, 1, 4)     \
+	X(0xAB, XRA, E, _, 1, 4)     \
+	X(0xAC, XRA, H, _, 1, 4)     \
+	X(0xAD, XRA, L, _, 1, 4)     \
+	X(0xAE, XRA, M, _, 1, 7)     \
+	X(0xAF, XRA, A, _, 1, 4)     \
+	X(0xB0, ORA, B, _, 1, 4)     \
+	X(0xB1, ORA, C, _, 1, 4)     \
+	X(0xB2, ORA, D, _, 1, 4)     \
+	X(0xB3, ORA, E, _, 1, 4)     \
+	X(0xB4, ORA, H, _, 1, 4)     \
+	X(0xB5, ORA, L, _, 1, 4)     \
+	X(0xB6, ORA, M, _, 1, 7)     \
+	X(0xB7, ORA, A, _, 1, 4)     \
+	X(0xB8, CMP, B, _, 1, 4)     \
+	X(0xB9, CMP, C, _, 1, 4)     \
+	X(0xBA, CMP, D, _, 1, 4)     \
+	X(0xBB, CMP, E, _, 1, 4)     \
+	X(0xBC, CMP, H, _, 1, 4)     \
+	X(0xBD, CMP, L, _, 1, 4)     \
+	X(0xBE, CMP, M, _, 1, 7)     \
+	X(0xBF, CMP, A, _, 1, 4)     \
+	X(0xC0, RETC, NZ, _, 1, 5)   \
+	X(0xC1, POP, BC, _, 1, 10)   \
+	X(0xC2, JMPC, NZ, _, 3, 10)  \
+	X(0xC3, JMP, _, _, 3, 10)    \
+	X(0xC4, CALLC, NZ, _, 3, 11) \
+	X(0xC5, PUSH, BC, _, 1, 11)  \
+	X(0xC6, ADI, _, _, 2, 7)     \
+	X(0xC7, RST, 0, _, 1, 11)    \
+	X(0xC8, RETC, Z, _, 1, 5)    \
+	X(0xC9, RET, _, _, 1, 10)    \
+	X(0xCA, JMPC, Z, _, 3, 10)   \
+	X(0xCB, JMP, _, _, 3, 10)    \
+	X(0xCC, CALLC, Z, _, 3, 11)  \
+	X(0xCD, CALL, _, _, 3, 17)   \
+	X(0xCE, ACI, _, _, 2, 7)     \
+	X(0xCF, RST, 1, _, 1, 11)    \
+	X(0xD0, RETC, NC, _, 1, 5)   \
+	X(0xD1, POP, DE, _, 1, 10)   \
+	X(0xD2, JMPC, NC, _, 3, 10)  \
+	X(0xD3, OUT, _, _, 2, 10)    \
+	X(0xD4, CALLC, NC, _, 3, 11) \
+	X(0xD5, PUSH, DE, _, 1, 11)  \
+	X(0xD6, SUI, _, _, 2, 7)     \
+	X(0xD7, RST, 2, _, 1, 11)    \
+	X(0xD8, RETC, C, _, 1, 5)    \
+	X(0xD9, RET, _, _, 1, 10)    \
+	X(0xDA, JMPC, C, _, 3, 10)   \
+	X(0xDB, IN, _, _, 2, 10)     \
+	X(0xDC, CALLC, C, _, 3, 11)  \
+	X(0xDD, CALL, _, _, 3, 17)   \
+	X(0xDE, SBI, _, _, 2, 7)     \
+	X(0xDF, RST, 3, _, 1, 11)    \
+	X(0xE0, RETC, PO, _, 1, 5)   \
+	X(0xE1, POP, HL, _, 1, 10)   \
+	X(0xE2, JMPC, PO, _, 3, 10)  \
+	X(0xE3, XTHL, _, _, 1, 18)   \
+	X(0xE4, CALLC, PO, _, 3, 11) \
+	X(0xE5, PUSH, HL, _, 1, 11)  \
+	X(0xE6, ANI, _, _, 2, 7)     \
+	X(0xE7, RST, 4, _, 1, 11)    \
+	X(0xE8, RETC, PE, _, 1, 5)   \
+	X(0xE9, PCHL, _, _, 1, 5)    \
+	X(0xEA, JMPC, PE, _, 3, 10)  \
+	X(0xEB, XCHG, _, _, 1, 4)    \
+	X(0xEC, CALLC, PE, _, 3, 11) \
+	X(0xED, CALL, _, _, 3, 17)   \
+	X(0xEE, XRI, _, _, 2, 7)     \
+	X(0xEF, RST, 5, _, 1, 11)    \
+	X(0xF0, RETC, P, _, 1, 5)    \
+	X(0xF1, POP, PSW, _, 1, 10)  \
+	X(0xF2, JMPC, P, _, 3, 10)   \
+	X(0xF3, DI, _, _, 1, 4)      \
+	X(0xF4, CALLC, P, _, 3, 11)  \
+	X(0xF5, PUSH, PSW, _, 1, 11) \
+	X(0xF6, ORI, _, _, 2, 7)     \
+	X(0xF7, RST, 6, _, 1, 11)    \
+	X(0xF8, RETC, M, _, 1, 5)    \
+	X(0xF9, SPHL, _, _, 1, 5)    \
+	X(0xFA, JMPC, M, _, 3, 10)   \
+	X(0xFB, EI, _, _, 1, 4)      \
+	X(0xFC, CALLC, M, _, 3, 11)  \
+	X(0xFD, CALL, _, _, 3, 17)   \
+	X(0xFE, CPI, _, _, 2, 7)     \
+	X(0xFF, RST, 7, _, 1, 11)
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+
+// Optional execution profiler (build with -DPROFILE=ON).
+//
+// step() and step_cycles() count the executions and cycles of every opcode
+// and every address, and how often every conditional jump, call and return
+// at an address was taken. The AOT and dynarec code is not profiled, those
+// builds run the interpreter instead. Without CPU_PROFILE none of this is
+// compiled.
+//
+// writeProfile() writes the report (profile.txt: totals, hot opcodes, hot
+// addresses, branches) and the ROM coverage (coverage.pbm: one pixel per ROM
+// byte, 128 bytes per row, black if it was executed as part of an
+// instruction). Sending SIGUSR1 writes them as well, at the next call of
+// step_cycles().
+//
+// Every machine has its own profile (see machine.h).
+typedef struct profile profile_t;
+
+// Allocate a cleared profile, exits on failure
+profile_t *createProfile(void);
+
+void destroyProfile(profile_t *profile);
+
+// Record one instruction: the address it was at (unless an interrupt
+// injected it), its cycles and the PC after it
+void profileStep(profile_t *profile, uint16_t pc, uint8_t opcode,
+				 uint8_t cycles, uint16_t nextPC, uint8_t interrupt);
+
+// Write the report and the coverage bitmap into the working directory
+void writeProfile(const profile_t *profile);
+
+// Write them if SIGUSR1 was received since the last call
+void pollProfileSignal(const profile_t *profile);
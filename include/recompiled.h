@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+#include "cpu.h"
+
+// The ROM recompiled to C by tools/recompile.c, only in the SeaInvadersAOT
+// build. Every basic block reachable from the reset and RST vectors is a
+// piece of straight line code, anything else (RET, PCHL, code in RAM,
+// pending interrupts, the end of the cycle budget) is left to step().
+
+// Hash (hashBytes()) of the ROM the code was generated from
+extern const uint64_t recompiledROMHash;
+
+// Same as step_cycles(), but only valid for that ROM
+uint32_t runRecompiled(cpu_t *cpu, uint32_t budget);
@@ -1,8 +1,13 @@
 #pragma once
-#include "memory.h"
+#include "bus.h"
 
 void initSDL(void);
 
 void killSDL(void);
 
-void drawScreen(memory_t *memory);
+// Draw the VRAM stripes written since the last call, does nothing if the
+// VRAM did not change
+void drawScreen(bus_t *bus);
+
+// Redraw the whole screen on the next drawScreen call (e.g. after a resize)
+void invalidateScreen(void);
@@ -0,0 +1,75 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "machine.h"
+#include "savestate.h"
+
+/*
+ *  Rewind history with a fixed amount of memory.
+ *
+ *  Only the newest recorded state is kept as a whole. Every older frame is
+ *  stored as the XOR of it and the frame after it, run length encoded, so
+ *  the few hundred bytes that change per frame is all that is stored.
+ *  Going back one frame XORs the newest delta into the newest state. When
+ *  the buffer is full the oldest frames are dropped.
+ *
+ *  Encoded delta: a list of runs, each one is
+ *
+ *      uint16_t skip    bytes that did not change
+ *      uint16_t length  bytes that did
+ *      uint8_t  xor[length]
+ */
+
+#define REWIND_SECONDS 60
+#define REWIND_FRAMES (REWIND_SECONDS * 60)
+// The game changes about 100 bytes per frame, so this holds REWIND_FRAMES
+// with plenty of room for busy scenes
+#define REWIND_BUFFER_SIZE (2 * 1024 * 1024)
+
+// Largest possible encoded delta, every run covers at least 1 changed byte
+// and (except for the last one) 4 unchanged ones
+#define REWIND_MAX_DELTA                                      \
+	(sizeof(savestate_t) + 4 * (sizeof(savestate_t) / 5 + 1))
+
+typedef struct rewind_frame {
+	uint32_t offset; // Start of the delta in the buffer
+	uint32_t size;
+} rewind_frame_t;
+
+typedef struct rewind {
+	uint8_t *buffer;
+	size_t bufferSize;
+	rewind_frame_t *frames; // Ring of the recorded deltas, oldest first
+	uint32_t maxFrames;
+	uint32_t first; // Oldest delta in frames
+	uint32_t count;
+	size_t bytesUsed; // Sum of the delta sizes
+	uint8_t hasState; // newest is valid
+	savestate_t newest; // Last recorded (or rewound to) state
+	savestate_t snapshot;
+	uint8_t encoded[REWIND_MAX_DELTA];
+} rewind_t;
+
+typedef struct rewind_stats {
+	uint32_t frames; // Frames that can be rewound
+	size_t bytesUsed; // Encoded deltas
+	size_t memory; // Everything the history allocated
+} rewind_stats_t;
+
+// Allocate the history, keeps at most maxFrames frames in bufferSize bytes
+void initRewind(rewind_t *history, uint32_t maxFrames, size_t bufferSize);
+
+void freeRewind(rewind_t *history);
+
+// Forget every recorded frame
+void clearRewind(rewind_t *history);
+
+// Record the current state of the machine, once per frame
+void recordFrame(rewind_t *history, const machine_t *machine);
+
+// Restore the machine to the frame before the last recorded one. Returns 0
+// if there is no older frame (the machine is set to the oldest one then).
+uint8_t rewindFrame(rewind_t *history, machine_t *machine);
+
+rewind_stats_t getRewindStats(const rewind_t *history);
@@ -0,0 +1,54 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "idle_loop.h"
+
+// The ROM can't be written, so every address in it is decoded once after
+// loadROM() and step_cycles() takes the opcode and its operand from here
+// instead of going through the bus.
+
+// Instructions starting in the last 2 bytes may read their operand from RAM,
+// they are left to the normal fetch
+#define ROM_SIZE 0x2000
+#define ROM_CACHE_SIZE (ROM_SIZE - 2)
+
+typedef struct decoded {
+	uint8_t opcode;
+	uint8_t idleLoop; // 1 + index into idleLoops if it jumps back in one
+	uint16_t operand; // The 1 or 2 bytes after the opcode (little endian)
+} decoded_t;
+
+typedef struct rom_cache {
+	decoded_t decoded[ROM_CACHE_SIZE];
+	uint16_t size; // Addresses below it are decoded, 0 for flat memory
+	idle_loop_t idleLoops[IDLE_LOOPS_MAX]; // See idle_loop.h
+	uint8_t idleLoopCount;
+	uint64_t hash; // FNV-1a hash of the ROM, see hashBytes()
+} rom_cache_t;
+
+// Decode every address of the ROM (ROM_SIZE bytes) and find its idle loops
+void decodeROM(rom_cache_t *cache, const uint8_t *rom);
+
+// 64 bit FNV-1a hash
+static inline uint64_t hashBytes(const uint8_t *data, size_t size)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+// Return the decoded instruction at address or NULL if it isn't in the ROM
+// (A15 is not decoded, so 0x8000 - 0x9FFF is cached as well)
+static inline const decoded_t *getDecoded(const rom_cache_t *cache,
+											uint16_t address)
+{
+	address &= 0x7FFF;
+
+	return address < cache->size ? &cache->decoded[address] : NULL;
+}
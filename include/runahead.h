@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+
+#include "machine.h"
+#include "savestate.h"
+
+/*
+ *  Run-ahead hides the input lag of the game: after the real frame the
+ *  machine is saved, runs frames more frames with the same input, the last
+ *  one of them is shown and the machine is restored again. The player sees
+ *  the reaction to the input of this frame up to frames frames earlier, at
+ *  the cost of emulating frames + 1 frames per frame.
+ */
+
+#define RUNAHEAD_MAX_FRAMES 8
+
+// Emulate one frame, draw it if draw is set
+typedef void (*frame_function_t)(machine_t *machine, uint8_t draw);
+
+typedef struct runahead {
+	uint8_t frames; // 0 -> off
+	savestate_t state;
+	// Host time spent on running ahead (save, frames, restore)
+	uint64_t totalNS;
+	uint64_t maxNS;
+	uint64_t count;
+} runahead_t;
+
+void initRunAhead(runahead_t *runahead, uint32_t frames);
+
+// Show the frame runahead->frames frames ahead of the machine, which has
+// to be called after the real frame. The machine is left unchanged.
+void runAhead(runahead_t *runahead, machine_t *machine,
+			  frame_function_t frame);
+
+// Print the host time running ahead added per frame
+void printRunAheadStats(const runahead_t *runahead);
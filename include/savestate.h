@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+
+#include "machine.h"
+#include "scheduler.h"
+
+/*
+ *  Save states contain everything a machine can change: the CPU registers,
+ *  the input ports, the shift register, the scheduled events (see
+ *  scheduler.h), the RAM and the VRAM. The ROM is not part of it, only its
+ *  hash, so a state can only be restored into a machine running the same
+ *  ROM.
+ *
+ *  A state is a fixed size struct that can be written to a file as it is
+ *  (multi-byte fields are in host byte order, i.e. little endian). Taking
+ *  and restoring one is a few field copies and two memcpy()s.
+ */
+
+#define SAVESTATE_MAGIC 0x53564953 // "SIVS"
+#define SAVESTATE_VERSION 2
+
+typedef struct savestate {
+	uint32_t magic; // SAVESTATE_MAGIC
+	uint16_t version; // SAVESTATE_VERSION
+	uint16_t size; // sizeof(savestate_t)
+	uint64_t romHash; // rom_cache_t.hash of the ROM the state belongs to
+	uint64_t instructions;
+	uint64_t cycles; // scheduler_t.now
+	uint64_t events[EVENT_COUNT]; // Time of every event or EVENT_NEVER
+	uint16_t BC;
+	uint16_t DE;
+	uint16_t HL;
+	uint16_t SP;
+	uint16_t PC;
+	uint16_t shiftValue;
+	uint8_t A;
+	uint8_t F; // With every lazy flag resolved
+	uint8_t opcode;
+	uint8_t interrupt;
+	uint8_t interrupt_enabled;
+	uint8_t shiftOffset;
+	uint8_t io_port[0x8];
+	uint8_t halted;
+	uint8_t reserved[5]; // Always 0
+	uint8_t ram[0x400];
+	uint8_t vram[0x1C00];
+} savestate_t;
+
+_Static_assert(sizeof(savestate_t) == 8272, "savestate_t must not be padded");
+
+enum SAVESTATE_RESULT {
+	SAVESTATE_OK,
+	SAVESTATE_INVALID, // Not a save state or truncated
+	SAVESTATE_WRONG_VERSION,
+	SAVESTATE_WRONG_ROM // Taken with a different ROM
+};
+
+// Copy the state of the machine into state
+void snapshotState(const machine_t *machine, savestate_t *state);
+
+// Replace the state of the machine, the machine is left untouched unless
+// SAVESTATE_OK is returned
+enum SAVESTATE_RESULT restoreState(machine_t *machine,
+								   const savestate_t *state);
+
+// Write a snapshot of the machine to the file at path, returns 0 on failure
+uint8_t saveStateToFile(const machine_t *machine, const char *path);
+
+// Restore the machine from the file at path
+enum SAVESTATE_RESULT loadStateFromFile(machine_t *machine, const char *path);
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ *  Events of the board at fixed CPU cycles, e.g. the two interrupts of the
+ *  screen. The CPU runs exactly until the next event is due (see
+ *  runUntilEvent() in machine.h). Instructions can't be interrupted, so the
+ *  last one may run over the time of the event. Those cycles are not lost,
+ *  the clock keeps counting from where the CPU stopped.
+ *
+ *  The events are kept in a binary min-heap ordered by their time. Every
+ *  type of event is scheduled at most once.
+ */
+
+// CPU -> 2 000 000 HZ, Screen -> 60 HZ
+#define CPU_CLOCK 2000000
+#define CYCLES_PER_FRAME (CPU_CLOCK / 60)
+
+// Time of an event that is not scheduled
+#define EVENT_NEVER UINT64_MAX
+
+enum EVENT {
+	EVENT_MID_SCREEN, // The beam is in the middle of the screen (RST 1)
+	EVENT_VBLANK, // The beam reached the end of the screen (RST 2)
+	EVENT_COUNT
+};
+
+typedef struct event {
+	uint64_t time; // Cycle the event is due at
+	uint8_t type; // enum EVENT
+} event_t;
+
+typedef struct scheduler {
+	uint64_t now; // Cycles since the machine was reset
+	event_t heap[EVENT_COUNT]; // heap[0] is the next event
+	uint8_t count;
+} scheduler_t;
+
+// Start at cycle 0 without any events
+void initScheduler(scheduler_t *scheduler);
+
+// Schedule the event type at time, replaces it if it is already scheduled
+void scheduleEvent(scheduler_t *scheduler, uint8_t type, uint64_t time);
+
+// Remove the next event and return it, there has to be one
+event_t popEvent(scheduler_t *scheduler);
+
+// Time the event type is scheduled at, EVENT_NEVER if it isn't
+uint64_t getEventTime(const scheduler_t *scheduler, uint8_t type);
+
+// Cycles until the next event, 0 if it is due already
+static inline uint64_t cyclesUntilEvent(const scheduler_t *scheduler)
+{
+	uint64_t time = scheduler->count ? scheduler->heap[0].time : EVENT_NEVER;
+
+	return time > scheduler->now ? time - scheduler->now : 0;
+}
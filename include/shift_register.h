@@ -1,8 +1,16 @@
 #pragma once
 #include <stdint.h>
 
-void setShiftRegister(uint8_t data);
+// Hardware shift register of the Space Invaders board (ports 2, 3 and 4)
+typedef struct shift_register {
+	uint16_t value; // The last two bytes written, newest in the high byte
+	uint8_t offset;
+} shift_register_t;
 
-void setShiftOffset(uint8_t offset);
+void initShiftRegister(shift_register_t *shift);
 
-uint8_t getShiftRegister(void);
+void setShiftRegister(shift_register_t *shift, uint8_t data);
+
+void setShiftOffset(shift_register_t *shift, uint8_t offset);
+
+uint8_t getShiftRegister(const shift_register_t *shift);
@@ -0,0 +1,86 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ *  Optional instruction trace (build with -DTRACE=ON).
+ *
+ *  step() and step_cycles() record the CPU state of every instruction into a
+ *  ring of the last TRACE_ENTRIES instructions. Recording is a few stores per
+ *  instruction and never blocks: only the thread running the machine writes
+ *  to its ring and the ring is only read when it is written to a file, by
+ *  the same thread. The AOT and dynarec code is not traced, those builds
+ *  run the interpreter instead.
+ *
+ *  writeTrace() writes the ring to trace.bin, oldest instruction first. That
+ *  happens when the CPU crashes (cpu_crash()) and when SIGUSR2 is received,
+ *  at the next call of step_cycles(). tools/tracedump.c disassembles it.
+ *
+ *  File layout (host byte order):
+ *
+ *      trace_header_t
+ *      trace_entry_t entries[count]
+ */
+
+// Size of the ring, a power of 2 (16 bytes per entry)
+#ifndef TRACE_ENTRIES
+#define TRACE_ENTRIES (1 << 22)
+#endif
+
+_Static_assert((TRACE_ENTRIES & (TRACE_ENTRIES - 1)) == 0,
+			   "TRACE_ENTRIES must be a power of 2");
+
+#define TRACE_MAGIC 0x54564953 // "SIVT"
+#define TRACE_VERSION 1
+
+// Set in trace_entry_t.cycles if an interrupt injected the opcode
+#define TRACE_INTERRUPT 0x80
+
+// The state before the instruction was executed
+typedef struct trace_entry {
+	uint16_t pc;
+	uint16_t sp;
+	uint16_t bc;
+	uint16_t de;
+	uint16_t hl;
+	uint8_t a;
+	uint8_t f; // Resolved flags
+	uint8_t opcode;
+	uint8_t operand[2]; // The 2 bytes after the opcode
+	uint8_t cycles; // Cycles it took, | TRACE_INTERRUPT
+} trace_entry_t;
+
+_Static_assert(sizeof(trace_entry_t) == 16,
+			   "trace_entry_t must not be padded");
+
+typedef struct trace_header {
+	uint32_t magic; // TRACE_MAGIC
+	uint16_t version; // TRACE_VERSION
+	uint16_t entrySize; // sizeof(trace_entry_t)
+	uint64_t count; // Entries in the file
+	uint64_t first; // Number of the first entry, counting from 0
+} trace_header_t;
+
+_Static_assert(sizeof(trace_header_t) == 24,
+			   "trace_header_t must not be padded");
+
+typedef struct trace {
+	trace_entry_t *entries; // TRACE_ENTRIES
+	uint64_t recorded; // Instructions recorded so far
+} trace_t;
+
+// Allocate an empty trace, exits on failure
+trace_t *createTrace(void);
+
+void destroyTrace(trace_t *trace);
+
+// The entry to record the next instruction in, overwrites the oldest one
+static inline trace_entry_t *nextTraceEntry(trace_t *trace)
+{
+	return &trace->entries[trace->recorded++ & (TRACE_ENTRIES - 1)];
+}
+
+// Write the recorded instructions to trace.bin in the working directory
+void writeTrace(const trace_t *trace);
+
+// Write them if SIGUSR2 was received since the last call
+void pollTraceSignal(const trace_t *trace);
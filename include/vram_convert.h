@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+
+// Native (unrotated) resolution of the Space Invaders screen
+#define SCREEN_WIDTH 256
+#define SCREEN_HEIGHT 224
+
+// ARGB8888
+#define COLOR_ON 0xFF00FF00
+#define COLOR_OFF 0xFF000000
+
+/*
+ *  The converted framebuffer is already rotated for the cabinet orientation:
+ *  SCREEN_HEIGHT pixels per row and SCREEN_WIDTH rows.
+ *
+ *  The VRAM is processed in 32 stripes, one per byte column. Stripe n holds
+ *  the pixels x = n * 8 ... n * 8 + 7 which end up in the 8 framebuffer rows
+ *  SCREEN_WIDTH - 1 - x.
+ */
+#define VRAM_STRIPES 32
+
+typedef enum vram_kernel {
+	VRAM_KERNEL_SCALAR,
+	VRAM_KERNEL_SSE2,
+	VRAM_KERNEL_AVX2
+} vram_kernel_t;
+
+// Select the fastest conversion kernel the host supports
+void initVRAMConverter(void);
+
+// Force a specific kernel, returns 0 if the host does not support it
+int setVRAMKernel(vram_kernel_t kernel);
+
+// Name of the currently selected kernel
+const char *getVRAMKernelName(void);
+
+// Convert the 1-bit VRAM into the rotated 32-bit framebuffer
+void convertVRAM(const uint8_t *vram, uint32_t *pixels);
+
+// Same as convertVRAM, but only for the stripes whose bit is set
+void convertVRAMStripes(const uint8_t *vram, uint32_t *pixels,
+						uint32_t stripes);
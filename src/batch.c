@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "bus.h"
+#include "headless.h"
+#include "host_time.h"
+#include "machine.h"
+#include "rom_cache.h"
+
+#define CACHE_LINE 64
+
+/*
+ *  Every worker owns a contiguous block of instances, allocated and
+ *  initialized by the worker thread itself. It runs them from the front of
+ *  its queue, and once that is empty it steals instances that have not
+ *  been started yet from the back of the other queues.
+ */
+typedef struct worker {
+	_Alignas(CACHE_LINE) pthread_mutex_t lock;
+	pthread_t thread;
+	struct batch *batch;
+	machine_t *machines; // Instances first ... first + count - 1
+	uint32_t first;
+	uint32_t count;
+	// Instances head ... tail - 1 (of this worker) have not been started
+	uint32_t head;
+	uint32_t tail;
+	uint32_t stolen; // Instances this worker took from other workers
+} worker_t;
+
+typedef struct batch {
+	const batch_config_t *config;
+	uint8_t rom[ROM_SIZE];
+	worker_t *workers;
+	uint32_t threads;
+	pthread_barrier_t ready; // Every worker has set up its instances
+	pthread_barrier_t go; // The start time has been taken
+	pthread_barrier_t done; // No worker runs any instance anymore
+} batch_t;
+
+static void *allocateAligned(size_t size)
+{
+	// aligned_alloc() wants a multiple of the alignment
+	size = (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+	void *memory = aligned_alloc(CACHE_LINE, size ? size : CACHE_LINE);
+
+	if (NULL == memory) {
+		fprintf(stderr, "Batch: out of memory!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return memory;
+}
+
+// Take the next instance of this worker, NULL if there is none left
+static machine_t *takeInstance(worker_t *worker)
+{
+	machine_t *machine = NULL;
+
+	pthread_mutex_lock(&worker->lock);
+
+	if (worker->head < worker->tail) {
+		machine = &worker->machines[worker->head++];
+	}
+
+	pthread_mutex_unlock(&worker->lock);
+
+	return machine;
+}
+
+// Take the last instance of another worker, NULL if every queue is empty
+static machine_t *stealInstance(worker_t *thief)
+{
+	batch_t *batch = thief->batch;
+	uint32_t self = thief - batch->workers;
+
+	for (uint32_t i = 1; i < batch->threads; i++) {
+		worker_t *victim = &batch->workers[(self + i) % batch->threads];
+		machine_t *machine = NULL;
+
+		pthread_mutex_lock(&victim->lock);
+
+		if (victim->head < victim->tail) {
+			machine = &victim->machines[--victim->tail];
+		}
+
+		pthread_mutex_unlock(&victim->lock);
+
+		if (machine) {
+			thief->stolen++;
+			return machine;
+		}
+	}
+
+	return NULL;
+}
+
+static void *runWorker(void *arg)
+{
+	worker_t *worker = arg;
+	batch_t *batch = worker->batch;
+	uint64_t frames = batch->config->frames;
+
+	// Set up by the thread that runs them, so the memory is local to it
+	worker->machines = allocateAligned(worker->count * sizeof(machine_t));
+
+	for (uint32_t i = 0; i < worker->count; i++) {
+		initMachine(&worker->machines[i]);
+		setROM(&worker->machines[i].bus, batch->rom);
+		worker->machines[i].idleSkip.enabled = batch->config->idleSkip;
+	}
+
+	worker->head = 0;
+	worker->tail = worker->count;
+	worker->stolen = 0;
+
+	pthread_barrier_wait(&batch->ready);
+	pthread_barrier_wait(&batch->go);
+
+	machine_t *machine;
+
+	while ((machine = takeInstance(worker)) ||
+		   (machine = stealInstance(worker))) {
+		for (uint64_t frame = 0; frame < frames; frame++) {
+			emulateFrameHeadless(&machine->cpu);
+		}
+	}
+
+	// Other workers may still run instances stolen from this one
+	pthread_barrier_wait(&batch->done);
+
+	for (uint32_t i = 0; i < worker->count; i++) {
+		freeMachine(&worker->machines[i]);
+	}
+
+	free(worker->machines);
+
+	return NULL;
+}
+
+// Run every instance with the given number of workers, returns the seconds
+// it took (without setting the instances up)
+static double runWithThreads(batch_t *batch, uint32_t threads,
+							 uint32_t *stolen)
+{
+	uint32_t instances = batch->config->instances;
+
+	batch->threads = threads;
+	batch->workers = allocateAligned(threads * sizeof(worker_t));
+	pthread_barrier_init(&batch->ready, NULL, threads + 1);
+	pthread_barrier_init(&batch->go, NULL, threads + 1);
+	pthread_barrier_init(&batch->done, NULL, threads + 1);
+
+	for (uint32_t i = 0; i < threads; i++) {
+		worker_t *worker = &batch->workers[i];
+
+		worker->batch = batch;
+		worker->first = (uint64_t)instances * i / threads;
+		worker->count = (uint64_t)instances * (i + 1) / threads - worker->first;
+		pthread_mutex_init(&worker->lock, NULL);
+
+		if (pthread_create(&worker->thread, NULL, runWorker, worker) != 0) {
+			fprintf(stderr, "Batch: could not create worker thread!\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// The workers only start once the time has been taken, otherwise the
+	// first instances could run before it
+	pthread_barrier_wait(&batch->ready);
+	uint64_t start = getTimeNS();
+	pthread_barrier_wait(&batch->go);
+	pthread_barrier_wait(&batch->done);
+	uint64_t elapsed = getTimeNS() - start;
+
+	*stolen = 0;
+
+	for (uint32_t i = 0; i < threads; i++) {
+		pthread_join(batch->workers[i].thread, NULL);
+		pthread_mutex_destroy(&batch->workers[i].lock);
+		*stolen += batch->workers[i].stolen;
+	}
+
+	pthread_barrier_destroy(&batch->ready);
+	pthread_barrier_destroy(&batch->go);
+	pthread_barrier_destroy(&batch->done);
+	free(batch->workers);
+	batch->workers = NULL;
+
+	return elapsed / 1e9;
+}
+
+uint8_t runBatch(const batch_config_t *config)
+{
+	batch_t batch = { .config = config };
+	uint32_t maxThreads = config->threads;
+
+	if (maxThreads == 0) {
+		long online = sysconf(_SC_NPROCESSORS_ONLN);
+		maxThreads = online > 0 ? online : 1;
+	}
+
+	// More workers than instances would only wait
+	if (maxThreads > config->instances) {
+		maxThreads = config->instances;
+	}
+
+	if (maxThreads == 0 || config->frames == 0) {
+		fprintf(stderr, "Batch run needs at least one instance and frame!\n");
+		return 0;
+	}
+
+	readROMFile(config->romPath, batch.rom);
+
+	printf("Batch run: %u instances, %llu frames each\n", config->instances,
+		   (unsigned long long)config->frames);
+	printf("  Threads  Frames/s      Speedup  Efficiency  Stolen\n");
+
+	double totalFrames = (double)config->instances * config->frames;
+	double baseline = 0;
+
+	for (uint32_t threads = 1;; threads *= 2) {
+		if (threads > maxThreads) {
+			threads = maxThreads;
+		}
+
+		uint32_t stolen;
+		double seconds = runWithThreads(&batch, threads, &stolen);
+		double framesPerSecond = totalFrames / seconds;
+
+		if (threads == 1) {
+			baseline = framesPerSecond;
+		}
+
+		double speedup = framesPerSecond / baseline;
+
+		printf("  %-7u  %-12.1f  %-7.2f  %9.1f%%  %u\n", threads,
+			   framesPerSecond, speedup, speedup / threads * 100, stolen);
+
+		if (threads == maxThreads) {
+			break;
+		}
+	}
+
+	return 1;
+}
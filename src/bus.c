@@ -3,20 +3,69 @@
 #include <string.h>
 
 #include "bus.h"
+#include "rom_cache.h"
 
-static memory_t *_memory = NULL;
-
-void initBus(memory_t *memory)
+void initBus(bus_t *bus, memory_t *memory)
 {
 	memset(memory->rom, 0, sizeof(memory->rom));
 	memset(memory->ram, 0, sizeof(memory->ram));
 	memset(memory->vram, 0, sizeof(memory->vram));
 
-	_memory = memory; // Saving a Reference
+	bus->memory = memory; // Saving a Reference
+	decodeROM(&bus->romCache, memory->rom);
+	bus->dirtyStripes = 0xFFFFFFFF; // Nothing has been drawn yet
+
+	for (int page = 0; page < PAGE_COUNT; page++) {
+		// A15 is not decoded, ROM is only selected if A13 and A14 are 0,
+		// everything else ends up in the RAM (0x2000 - 0x3FFF)
+		uint8_t decoded = page & 0x7F;
+
+		if (decoded < 0x20) {
+			bus->readPages[page] = &memory->rom[decoded * PAGE_SIZE];
+			bus->writePages[page] = bus->discardPage;
+			bus->vramPageMask[page] = 0;
+			continue;
+		}
+
+		uint16_t offset = (decoded & 0x1F) * PAGE_SIZE;
+
+		if (offset < sizeof(memory->ram)) {
+			bus->readPages[page] = &memory->ram[offset];
+			bus->vramPageMask[page] = 0;
+		} else {
+			bus->readPages[page] =
+				&memory->vram[offset - sizeof(memory->ram)];
+			bus->vramPageMask[page] = 0xFFFFFFFF;
+		}
+
+		bus->writePages[page] = bus->readPages[page];
+	}
 }
 
-//  Load the file at the given path into memory
-void loadROM(char *path)
+void mapFlatMemory(bus_t *bus, uint8_t *memory)
+{
+	for (int page = 0; page < PAGE_COUNT; page++) {
+		bus->readPages[page] = &memory[page * PAGE_SIZE];
+		bus->writePages[page] = bus->readPages[page];
+		bus->vramPageMask[page] = 0;
+	}
+
+	// Nothing is decoded, there are no idle loops and no ROM to recompile
+	bus->romCache.size = 0;
+	bus->romCache.idleLoopCount = 0;
+	bus->romCache.hash = 0;
+}
+
+uint32_t takeDirtyStripes(bus_t *bus)
+{
+	uint32_t stripes = bus->dirtyStripes;
+	bus->dirtyStripes = 0;
+
+	return stripes;
+}
+
+//  Read the ROM file at the given path into rom (ROM_SIZE bytes)
+void readROMFile(const char *path, uint8_t *rom)
 {
 	FILE *file = fopen(path, "rb");
 
@@ -29,75 +78,49 @@ void loadROM(char *path)
 	size_t size = ftell(file);
 	fseek(file, 0, SEEK_SET);
 
-	if (size > sizeof(_memory->rom)) {
-		fprintf(stderr, "Your ROM is too big! Max Size is %zu bytes!\n",
-				sizeof(_memory->rom));
+	if (size > ROM_SIZE) {
+		fprintf(stderr, "Your ROM is too big! Max Size is %d bytes!\n",
+				ROM_SIZE);
 		exit(EXIT_FAILURE);
 	}
 
-	size_t result = fread(_memory->rom, sizeof(_memory->rom), 1, file);
+	size_t result = fread(rom, ROM_SIZE, 1, file);
 
 	if (1 != result) {
 		fprintf(stderr, "Failed to load ROM into memory!");
 		exit(EXIT_FAILURE);
 	}
 
-	printf("Rom loaded successfully!\n");
-
 	fclose(file);
 	file = NULL;
 }
 
-/*
- *  Wrapper function around getAddressPointer.
- *  Returns only the value stored at the specified memory address
- */
-uint8_t readMemoryValue(uint16_t address)
+//  Load the file at the given path into memory
+void loadROM(bus_t *bus, const char *path)
 {
-	return *(getAddressPointer(address));
+	readROMFile(path, bus->memory->rom);
+	decodeROM(&bus->romCache, bus->memory->rom);
+
+	printf("Rom loaded successfully!\n");
 }
 
-//  Returns a pointer to specified address in memory
-uint8_t *getAddressPointer(uint16_t address)
+void setROM(bus_t *bus, const uint8_t *rom)
 {
-	if (address <= 0x1FFF) {
-		return &_memory->rom[address];
-	} else if (address >= 0x2000 && address <= 0x23FF) {
-		return &_memory->ram[address - 0x2000];
-	} else if (address >= 0x2400 && address <= 0x3FFF) {
-		return &_memory->vram[address - 0x2400];
-	} else if (address >= 0x4000 &&
-			   address <= 0x43FF) { // Mirror of RAM (Work RAM and VRAM?)
-		return &_memory->ram[address - 0x4000];
-	} else if (address >= 0x4400 && address <= 0x5FFF) { // Mirror of VRAM
-		return &_memory->vram[address - 0x4400];
-	} else {
-		fprintf(stderr,
-				"Error! Tried to read data from out-of-range address: %04x\n",
-				address);
+	memcpy(bus->memory->rom, rom, ROM_SIZE);
+	decodeROM(&bus->romCache, bus->memory->rom);
+}
 
-		exit(EXIT_FAILURE);
-	}
+//  Returns a pointer to specified address in memory
+uint8_t *getAddressPointer(const bus_t *bus, uint16_t address)
+{
+	return &bus->readPages[address >> 8][address & 0xFF];
 }
 
 //  Write a 8-Bit value to a specific address in memory
-void writeByteToMemory(uint8_t data, uint16_t address)
+void writeByteToMemory(bus_t *bus, uint8_t data, uint16_t address)
 {
-	if (address >= 0x2000 && address <= 0x23FF) {
-		_memory->ram[address - 0x2000] = data;
-	} else if (address >= 0x2400 && address <= 0x3FFF) {
-		_memory->vram[address - 0x2400] = data;
-	} else if (address >= 0x4000 && address <= 0x43FF) { // Mirror of RAM
-		_memory->ram[address - 0x4000] = data;
-	} else if (address >= 0x4400 && address <= 0x5FFF) { // Mirror of VRAM
-		// printf("VRAM (%x): %x\n", address, data);
-		_memory->vram[address - 0x4400] = data;
-	} else {
-		fprintf(stderr,
-				"Error! Tried to write data to out-of-range address: %04x "
-				"(data: %02x)\n",
-				address, data);
+	uint8_t page = address >> 8;
 
-		exit(EXIT_FAILURE);
-	}
+	bus->writePages[page][address & 0xFF] = data;
+	bus->dirtyStripes |= bus->vramPageMask[page] & (1u << (address % 32));
 }
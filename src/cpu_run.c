@@ -0,0 +1,273 @@
+#include <stdint.h>
+
+#include "cpu.h"
+#include "cpu_ops.h"
+#include "dynarec.h"
+#include "idle_loop.h"
+#include "machine.h"
+#include "opcodes.h"
+#include "profile.h"
+#include "recompiled.h"
+#include "rom_cache.h"
+#include "trace.h"
+
+// Batched version of step(). The registers are kept in locals for the whole
+// run, so the compiler can keep them in host registers, and every opcode is
+// expanded from opcodes.h with its operands fixed at compile time. Code in
+// the ROM is fetched pre-decoded from the ROM cache (see rom_cache.h).
+//
+// The SeaInvadersAOT build runs the ROM recompiled at build time instead
+// (see recompiled.h), as long as the loaded ROM is the one it was made from.
+//
+// Build with CPU_COMPUTED_GOTO to dispatch through a table of label
+// addresses (GCC/Clang extension) instead of a switch. With GCC the switch
+// was as fast or faster, so it is the default.
+
+// Bind the operation macros (cpu_ops.h) to the locals below
+#define REG_A a
+#define REG_F f
+#define REG_B bc.highByte
+#define REG_C bc.lowByte
+#define REG_D de.highByte
+#define REG_E de.lowByte
+#define REG_H hl.highByte
+#define REG_L hl.lowByte
+#define REG_BC bc.reg
+#define REG_DE de.reg
+#define REG_HL hl.reg
+#define REG_SP sp
+#define REG_PC pc
+#define LAZY lazy
+#define INT_ENABLED interrupt_enabled
+#define HALTED cpu->halted
+#define CYCLES cycles
+#define MACHINE machine
+#undef IMM8
+#undef IMM16
+#define IMM8() ((uint8_t)operand)
+#define IMM16() operand
+#define CRASH()         \
+	do {                \
+		SAVE_STATE();   \
+		TRACE_END();    \
+		CPU_CRASH(cpu); \
+	} while (0)
+
+#define SAVE_STATE()                                \
+	do {                                            \
+		cpu->AF.highByte = a;                       \
+		cpu->AF.lowByte = f;                        \
+		cpu->BC = bc;                               \
+		cpu->DE = de;                               \
+		cpu->HL = hl;                               \
+		cpu->SP = sp;                               \
+		cpu->PC = pc;                               \
+		cpu->lazy = lazy;                           \
+		cpu->opcode = opcode;                       \
+		cpu->interrupt = interrupt;                 \
+		cpu->interrupt_enabled = interrupt_enabled; \
+		cpu->instructions = instructions;           \
+	} while (0)
+
+// Fetch the next opcode and its operand, a pending interrupt replaces them
+// (see step())
+#define FETCH()                                               \
+	do {                                                      \
+		const decoded_t *decoded_ = getDecoded(romCache, pc); \
+		idleLoop = 0;                                         \
+		if (interrupt_enabled && interrupt) {                 \
+			opcode = interrupt;                               \
+			interrupt = 0;                                    \
+			interrupt_enabled = 0;                            \
+			ACCEPT_INTERRUPT();                               \
+		} else if (decoded_) {                                \
+			opcode = decoded_->opcode;                        \
+			operand = decoded_->operand;                      \
+			idleLoop = decoded_->idleLoop;                    \
+		} else {                                              \
+			opcode = MEM_READ(pc);                            \
+			operand = MEM_READ16(pc + 1);                     \
+		}                                                     \
+		instructions++;                                       \
+	} while (0)
+
+// Record every instruction like step() does with CPU_PROFILE (see profile.h)
+#ifdef CPU_PROFILE
+#define PROFILE_BEGIN()                                \
+	uint16_t profilePC_ = pc;                          \
+	uint32_t profileCycles_ = cycles;                  \
+	uint8_t profileInterrupt_ = interrupt_enabled && interrupt
+#define PROFILE_END()                                                 \
+	profileStep(profile, profilePC_, opcode, cycles - profileCycles_, \
+				pc, profileInterrupt_)
+#else
+#define PROFILE_BEGIN() (void)0
+#define PROFILE_END() (void)0
+#endif
+
+// Record every instruction like step() does with CPU_TRACE (see trace.h)
+#ifdef CPU_TRACE
+#define TRACE_BEGIN()                                                   \
+	uint32_t traceCycles_ = cycles;                                     \
+	trace_entry_t traced_ = {                                           \
+		.pc = pc,                                                       \
+		.sp = sp,                                                       \
+		.bc = bc.reg,                                                   \
+		.de = de.reg,                                                   \
+		.hl = hl.reg,                                                   \
+		.a = a,                                                         \
+		.f = lazy_get_flags(f, &lazy),                                  \
+		.cycles = interrupt_enabled && interrupt ? TRACE_INTERRUPT : 0, \
+	}
+// The entry is stored once the instruction is done, or in CRASH()
+#define TRACE_END()                           \
+	(traced_.opcode = opcode,                 \
+	 traced_.operand[0] = operand & 0xFF,     \
+	 traced_.operand[1] = operand >> 8,       \
+	 traced_.cycles |= cycles - traceCycles_, \
+	 *nextTraceEntry(trace) = traced_)
+#else
+#define TRACE_BEGIN() (void)0
+#define TRACE_END() (void)0
+#endif
+
+// Every instruction is recorded (profile or trace)
+#if defined(CPU_PROFILE) || defined(CPU_TRACE)
+#define CPU_INSTRUMENTED
+#endif
+
+// Skip the iterations of an idle loop that fit into the budget once its
+// jump back was taken (see idle_loop.h). The first iteration may have
+// started in the middle of the loop, so the skipping starts after the
+// second jump back in a row. No interrupt can come in while the skipped
+// iterations run: one that is pending now has to wait for an EI, which
+// idle loops don't contain.
+#ifndef CPU_INSTRUMENTED
+#define SKIP_IDLE_LOOP()                                                   \
+	do {                                                                   \
+		if (idleLoop) {                                                    \
+			const idle_loop_t *loop_ = &romCache->idleLoops[idleLoop - 1]; \
+			if (pc != loop_->start) {                                      \
+				idleLoopArmed = 0;                                         \
+			} else if (idleLoopArmed != idleLoop) {                        \
+				idleLoopArmed = idleLoop;                                  \
+			} else if (idleSkip->enabled && cycles < budget) {             \
+				uint32_t skipped_ = (budget - cycles) / loop_->cycles;     \
+				cycles += skipped_ * loop_->cycles;                        \
+				instructions += skipped_ * loop_->instructions;            \
+				idleSkip->hits[idleLoop - 1] += skipped_ != 0;             \
+				idleSkip->cycles += skipped_ * loop_->cycles;              \
+			}                                                              \
+		}                                                                  \
+	} while (0)
+#else
+#define SKIP_IDLE_LOOP() ((void)idleLoop, (void)idleLoopArmed, (void)idleSkip)
+#endif
+
+uint32_t step_cycles(cpu_t *cpu, uint32_t budget)
+{
+#ifdef CPU_PROFILE
+	profile_t *profile = cpu->machine->profile;
+	pollProfileSignal(profile);
+#endif
+#ifdef CPU_TRACE
+	trace_t *trace = cpu->machine->trace;
+	pollTraceSignal(trace);
+#endif
+
+#ifdef LAZY_FLAGS_VALIDATE
+	// The flags are checked in step(), so run that instead
+	uint32_t cycles = 0;
+
+	while (cycles < budget) {
+		cycles += step(cpu);
+	}
+
+	return cycles;
+#else
+	// The recompilers are not instrumented, the interpreter is used instead
+#if defined(CPU_AOT) && !defined(CPU_INSTRUMENTED)
+	if (cpu->machine->bus.romCache.hash == recompiledROMHash) {
+		return runRecompiled(cpu, budget);
+	}
+#endif
+
+#if defined(CPU_DYNAREC) && !defined(CPU_INSTRUMENTED)
+	if (cpu->machine->dynarec) {
+		return runDynarec(cpu->machine->dynarec, cpu, budget);
+	}
+#endif
+
+	machine_t *machine = cpu->machine;
+	const rom_cache_t *romCache = &machine->bus.romCache;
+	uint8_t a = cpu->AF.highByte;
+	uint8_t f = cpu->AF.lowByte;
+	reg_t bc = cpu->BC;
+	reg_t de = cpu->DE;
+	reg_t hl = cpu->HL;
+	uint16_t sp = cpu->SP;
+	uint16_t pc = cpu->PC;
+	lazy_flags_t lazy = cpu->lazy;
+	uint8_t opcode = cpu->opcode;
+	uint16_t operand = 0;
+	uint8_t interrupt = cpu->interrupt;
+	uint8_t interrupt_enabled = cpu->interrupt_enabled;
+	uint64_t instructions = cpu->instructions;
+	uint32_t cycles = 0;
+	idle_skip_t *idleSkip = &machine->idleSkip;
+	uint8_t idleLoop;
+	uint8_t idleLoopArmed = 0; // Its jump back was the last one taken
+
+#ifdef CPU_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+	static const void *labels[256] = {
+#define X(code, op, x, y, length, base) [code] = &&op_##code,
+		OPCODE_TABLE(X)
+#undef X
+	};
+
+	while (cycles < budget) {
+		PROFILE_BEGIN();
+		TRACE_BEGIN();
+		FETCH();
+		goto *labels[opcode];
+
+#define X(code, op, x, y, length, base) \
+	op_##code : OP_##op(x, y);          \
+	cycles += base;                     \
+	PROFILE_END();                      \
+	TRACE_END();                        \
+	SKIP_IDLE_LOOP();                   \
+	continue;
+		OPCODE_TABLE(X)
+#undef X
+	}
+
+#pragma GCC diagnostic pop
+#else
+	while (cycles < budget) {
+		PROFILE_BEGIN();
+		TRACE_BEGIN();
+		FETCH();
+
+		switch (opcode) {
+#define X(code, op, x, y, length, base) \
+	case code:                          \
+		OP_##op(x, y);                  \
+		cycles += base;                 \
+		break;
+			OPCODE_TABLE(X)
+#undef X
+		}
+
+		PROFILE_END();
+		TRACE_END();
+		SKIP_IDLE_LOOP();
+	}
+#endif
+
+	SAVE_STATE();
+	return cycles;
+#endif
+}
@@ -0,0 +1,619 @@
+#define _DEFAULT_SOURCE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "dynarec.h"
+#include "machine.h"
+
+#ifdef CPU_DYNAREC
+
+#include <sys/mman.h>
+
+#include "opcode_info.h"
+#include "rom_cache.h"
+
+/*
+ *  Register usage of the generated code:
+ *
+ *  rbx  cpu_t pointer
+ *  r12d cycles used so far
+ *  r13d cycle budget
+ *
+ *  All three are callee saved, so the opcode handlers can be called without
+ *  saving anything. Blocks are entered through enterCode() and leave through
+ *  exitStub, which returns the cycles to runDynarec(). cpu->PC is up to date
+ *  whenever a block is left.
+ */
+
+#define CODE_SIZE (4 * 1024 * 1024)
+#define MAX_BLOCK_INSTRUCTIONS 64
+// Upper bound for the code of one block (a handler call is 31 bytes)
+#define MAX_BLOCK_BYTES (MAX_BLOCK_INSTRUCTIONS * 48 + 128)
+#define MAX_LINKS 0x4000
+
+typedef struct block {
+	const uint8_t *entry; // NULL if not translated yet
+	uint32_t maxCycles; // Cycles if every conditional instruction is taken
+} block_t;
+
+// Jump in a block that should go to the block at target once it exists
+typedef struct link {
+	uint8_t *site; // rel32 of the jump
+	uint16_t target;
+} link_t;
+
+struct dynarec {
+	uint8_t *code;
+	uint8_t *blocksStart; // Everything after the entry and exit stubs
+	uint8_t *emitPtr;
+	const uint8_t *exitStub;
+	uint32_t (*enterCode)(cpu_t *cpu, uint32_t cycles, uint32_t budget,
+						  const uint8_t *entry);
+	uint64_t romHash; // ROM the blocks were translated from
+
+	block_t blocks[ROM_CACHE_SIZE];
+	link_t links[MAX_LINKS];
+	int linkCount;
+};
+
+#define OFFSET(field) ((uint32_t)offsetof(cpu_t, field))
+
+static void emit8(dynarec_t *dynarec, uint8_t byte)
+{
+	*dynarec->emitPtr++ = byte;
+}
+
+static void emit16(dynarec_t *dynarec, uint16_t word)
+{
+	memcpy(dynarec->emitPtr, &word, sizeof(word));
+	dynarec->emitPtr += sizeof(word);
+}
+
+static void emit32(dynarec_t *dynarec, uint32_t dword)
+{
+	memcpy(dynarec->emitPtr, &dword, sizeof(dword));
+	dynarec->emitPtr += sizeof(dword);
+}
+
+static void emit64(dynarec_t *dynarec, uint64_t qword)
+{
+	memcpy(dynarec->emitPtr, &qword, sizeof(qword));
+	dynarec->emitPtr += sizeof(qword);
+}
+
+static void emitBytes(dynarec_t *dynarec, const uint8_t *bytes, size_t count)
+{
+	memcpy(dynarec->emitPtr, bytes, count);
+	dynarec->emitPtr += count;
+}
+
+// Point the rel32 at site to dest
+static void patch(uint8_t *site, const uint8_t *dest)
+{
+	int32_t rel = (int32_t)(dest - (site + 4));
+	memcpy(site, &rel, sizeof(rel));
+}
+
+// Offset of an 8 bit register (enum OPERAND) in cpu_t, -1 for M
+static int32_t reg8Offset(uint8_t reg)
+{
+	switch (reg) {
+	case OPERAND_A:
+		return OFFSET(AF.highByte);
+	case OPERAND_B:
+		return OFFSET(BC.highByte);
+	case OPERAND_C:
+		return OFFSET(BC.lowByte);
+	case OPERAND_D:
+		return OFFSET(DE.highByte);
+	case OPERAND_E:
+		return OFFSET(DE.lowByte);
+	case OPERAND_H:
+		return OFFSET(HL.highByte);
+	case OPERAND_L:
+		return OFFSET(HL.lowByte);
+	default:
+		return -1;
+	}
+}
+
+// Offset of a register pair (enum OPERAND) in cpu_t, -1 for PSW
+static int32_t reg16Offset(uint8_t pair)
+{
+	switch (pair) {
+	case OPERAND_BC:
+		return OFFSET(BC);
+	case OPERAND_DE:
+		return OFFSET(DE);
+	case OPERAND_HL:
+		return OFFSET(HL);
+	case OPERAND_SP:
+		return OFFSET(SP);
+	default:
+		return -1;
+	}
+}
+
+// movzx eax/ecx, byte [rbx + offset]
+static void emitLoad8(dynarec_t *dynarec, uint8_t reg, uint32_t offset)
+{
+	emitBytes(dynarec, (uint8_t[]){ 0x0F, 0xB6, 0x83 | reg << 3 }, 3);
+	emit32(dynarec, offset);
+}
+
+// mov byte [rbx + offset], al/cl
+static void emitStore8(dynarec_t *dynarec, uint8_t reg, uint32_t offset)
+{
+	emitBytes(dynarec, (uint8_t[]){ 0x88, 0x83 | reg << 3 }, 2);
+	emit32(dynarec, offset);
+}
+
+// mov byte [rbx + offset], value
+static void emitStoreImm8(dynarec_t *dynarec, uint32_t offset, uint8_t value)
+{
+	emitBytes(dynarec, (uint8_t[]){ 0xC6, 0x83 }, 2);
+	emit32(dynarec, offset);
+	emit8(dynarec, value);
+}
+
+// mov word [rbx + offset], value
+static void emitStoreImm16(dynarec_t *dynarec, uint32_t offset, uint16_t value)
+{
+	emitBytes(dynarec, (uint8_t[]){ 0x66, 0xC7, 0x83 }, 3);
+	emit32(dynarec, offset);
+	emit16(dynarec, value);
+}
+
+#define EAX 0
+#define ECX 1
+
+// jmp/je to the block at target, or to the exit until that block exists
+static void emitLink(dynarec_t *dynarec, const uint8_t *opcode, size_t length,
+					 uint16_t target)
+{
+	emitBytes(dynarec, opcode, length);
+	uint8_t *site = dynarec->emitPtr;
+	emit32(dynarec, 0);
+
+	if (target < ROM_CACHE_SIZE && dynarec->blocks[target].entry) {
+		patch(site, dynarec->blocks[target].entry);
+		return;
+	}
+
+	patch(site, dynarec->exitStub);
+
+	if (target < ROM_CACHE_SIZE && dynarec->linkCount < MAX_LINKS) {
+		dynarec->links[dynarec->linkCount].site = site;
+		dynarec->links[dynarec->linkCount].target = target;
+		dynarec->linkCount++;
+	}
+}
+
+static void emitJump(dynarec_t *dynarec, uint16_t target)
+{
+	emitLink(dynarec, (uint8_t[]){ 0xE9 }, 1, target);
+}
+
+// Jump to target if cpu->PC == target
+static void emitJumpIfPC(dynarec_t *dynarec, uint16_t target)
+{
+	// cmp word [rbx + PC], target
+	emitBytes(dynarec, (uint8_t[]){ 0x66, 0x81, 0xBB }, 3);
+	emit32(dynarec, OFFSET(PC));
+	emit16(dynarec, target);
+
+	emitLink(dynarec, (uint8_t[]){ 0x0F, 0x84 }, 2, target);
+}
+
+static void emitExit(dynarec_t *dynarec)
+{
+	emit8(dynarec, 0xE9);
+	uint8_t *site = dynarec->emitPtr;
+	emit32(dynarec, 0);
+	patch(site, dynarec->exitStub);
+}
+
+// Call the interpreter's handler, it adds its cycles itself
+static void emitHandlerCall(dynarec_t *dynarec, uint8_t opcode)
+{
+	uint64_t handler = (uint64_t)(uintptr_t)opcodeHandlers[opcode];
+
+	emitBytes(dynarec, (uint8_t[]){ 0x48, 0x89, 0xDF }, 3); // mov rdi, rbx
+	emitBytes(dynarec, (uint8_t[]){ 0x48, 0xB8 }, 2); // mov rax, handler
+	emit64(dynarec, handler);
+	emitBytes(dynarec, (uint8_t[]){ 0xFF, 0xD0 }, 2); // call rax
+	emitBytes(dynarec, (uint8_t[]){ 0x0F, 0xB6, 0xC0 }, 3); // movzx eax, al
+	emitBytes(dynarec, (uint8_t[]){ 0x41, 0x01, 0xC4 }, 3); // add r12d, eax
+}
+
+// ADD, SUB, ANA, XRA, ORA, CMP and their immediate versions, the lazy flags
+// are recorded like lazy_record() does. The operand is in ecx.
+static void emitALU(dynarec_t *dynarec, uint8_t instruction)
+{
+	uint8_t op;
+	uint8_t lazyOp;
+	uint8_t store = 1;
+
+	switch (instruction) {
+	case INSTR_ADD:
+	case INSTR_ADI:
+		op = 0x00;
+		lazyOp = LAZY_ADD;
+		break;
+	case INSTR_SUB:
+	case INSTR_SUI:
+		op = 0x28;
+		lazyOp = LAZY_SUB;
+		break;
+	case INSTR_CMP:
+	case INSTR_CPI:
+		op = 0x28;
+		lazyOp = LAZY_SUB;
+		store = 0;
+		break;
+	case INSTR_ANA:
+	case INSTR_ANI:
+		op = 0x20;
+		lazyOp = LAZY_ANA;
+		break;
+	case INSTR_XRA:
+	case INSTR_XRI:
+		op = 0x30;
+		lazyOp = LAZY_LOGIC;
+		break;
+	default: // ORA, ORI
+		op = 0x08;
+		lazyOp = LAZY_LOGIC;
+		break;
+	}
+
+	emitLoad8(dynarec, EAX, OFFSET(AF.highByte));
+	emitStoreImm8(dynarec, OFFSET(lazy.op), lazyOp);
+
+	if (lazyOp == LAZY_LOGIC) {
+		emitStoreImm8(dynarec, OFFSET(lazy.byte1), 0);
+		emitStoreImm8(dynarec, OFFSET(lazy.byte2), 0);
+	} else {
+		emitStore8(dynarec, EAX, OFFSET(lazy.byte1));
+		emitStore8(dynarec, ECX, OFFSET(lazy.byte2));
+		emitStoreImm8(dynarec, OFFSET(lazy.carry), 0); // No carry-in
+	}
+
+	emitBytes(dynarec, (uint8_t[]){ op, 0xC8 }, 2); // <op> al, cl
+	emitStore8(dynarec, EAX, OFFSET(lazy.result));
+
+	if (store) {
+		emitStore8(dynarec, EAX, OFFSET(AF.highByte));
+	}
+}
+
+static uint8_t isALU(uint8_t instruction)
+{
+	switch (instruction) {
+	case INSTR_ADD:
+	case INSTR_SUB:
+	case INSTR_ANA:
+	case INSTR_XRA:
+	case INSTR_ORA:
+	case INSTR_CMP:
+	case INSTR_ADI:
+	case INSTR_SUI:
+	case INSTR_ANI:
+	case INSTR_XRI:
+	case INSTR_ORI:
+	case INSTR_CPI:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+// Emit native code for the simple instructions, returns 0 if the handler has
+// to be called instead
+static uint8_t emitInline(dynarec_t *dynarec, uint8_t opcode, uint16_t operand)
+{
+	const opcode_info_t *info = &opcodeInfo[opcode];
+	uint8_t instruction = info->instruction;
+
+	if (instruction == INSTR_NOP) {
+		return 1;
+	}
+
+	if (instruction == INSTR_MOV) {
+		int32_t dest = reg8Offset(info->x);
+		int32_t src = reg8Offset(info->y);
+
+		if (dest < 0 || src < 0) {
+			return 0;
+		}
+
+		emitLoad8(dynarec, EAX, src);
+		emitStore8(dynarec, EAX, dest);
+		return 1;
+	}
+
+	if (instruction == INSTR_MVI) {
+		int32_t dest = reg8Offset(info->x);
+
+		if (dest < 0) {
+			return 0;
+		}
+
+		emitStoreImm8(dynarec, dest, operand & 0xFF);
+		return 1;
+	}
+
+	if (instruction == INSTR_LXI) {
+		emitStoreImm16(dynarec, reg16Offset(info->x), operand);
+		return 1;
+	}
+
+	if (instruction == INSTR_INX || instruction == INSTR_DCX) {
+		// inc/dec word [rbx + offset]
+		uint8_t modrm = instruction == INSTR_INX ? 0x83 : 0x8B;
+		emitBytes(dynarec, (uint8_t[]){ 0x66, 0xFF, modrm }, 3);
+		emit32(dynarec, reg16Offset(info->x));
+		return 1;
+	}
+
+	if (instruction == INSTR_XCHG) {
+		// movzx eax, word [HL]; movzx ecx, word [DE]
+		emitBytes(dynarec, (uint8_t[]){ 0x0F, 0xB7, 0x83 }, 3);
+		emit32(dynarec, OFFSET(HL));
+		emitBytes(dynarec, (uint8_t[]){ 0x0F, 0xB7, 0x8B }, 3);
+		emit32(dynarec, OFFSET(DE));
+		emitBytes(dynarec, (uint8_t[]){ 0x66, 0x89, 0x83 }, 3); // mov [DE], ax
+		emit32(dynarec, OFFSET(DE));
+		emitBytes(dynarec, (uint8_t[]){ 0x66, 0x89, 0x8B }, 3); // mov [HL], cx
+		emit32(dynarec, OFFSET(HL));
+		return 1;
+	}
+
+	if (instruction == INSTR_CMA) {
+		emitBytes(dynarec, (uint8_t[]){ 0xF6, 0x93 }, 2); // not byte [A]
+		emit32(dynarec, OFFSET(AF.highByte));
+		return 1;
+	}
+
+	if (isALU(instruction)) {
+		if (info->length == 2) {
+			emit8(dynarec, 0xB9); // mov ecx, operand
+			emit32(dynarec, operand & 0xFF);
+		} else if (reg8Offset(info->x) >= 0) {
+			emitLoad8(dynarec, ECX, reg8Offset(info->x));
+		} else {
+			return 0;
+		}
+
+		emitALU(dynarec, instruction);
+		return 1;
+	}
+
+	return 0;
+}
+
+// Throw away all blocks and start over with an empty code buffer
+static void flushBlocks(dynarec_t *dynarec)
+{
+	memset(dynarec->blocks, 0, sizeof(dynarec->blocks));
+	dynarec->linkCount = 0;
+	dynarec->emitPtr = dynarec->blocksStart;
+}
+
+// Point every pending jump to the new block at pc
+static void resolveLinks(dynarec_t *dynarec, uint16_t pc)
+{
+	for (int i = 0; i < dynarec->linkCount;) {
+		if (dynarec->links[i].target != pc) {
+			i++;
+			continue;
+		}
+
+		patch(dynarec->links[i].site, dynarec->blocks[pc].entry);
+		dynarec->links[i] = dynarec->links[--dynarec->linkCount];
+	}
+}
+
+static block_t *compileBlock(dynarec_t *dynarec, const rom_cache_t *romCache,
+							 uint16_t pc)
+{
+	if (dynarec->code + CODE_SIZE - dynarec->emitPtr < MAX_BLOCK_BYTES) {
+		flushBlocks(dynarec);
+	}
+
+	uint8_t *entry = dynarec->emitPtr;
+
+	// Leave the block to step() if the budget could run out in it:
+	// lea eax, [r12 + maxCycles]; cmp eax, r13d; jae exit
+	emitBytes(dynarec, (uint8_t[]){ 0x41, 0x8D, 0x84, 0x24 }, 4);
+	uint8_t *maxCyclesSite = dynarec->emitPtr;
+	emit32(dynarec, 0);
+	emitBytes(dynarec, (uint8_t[]){ 0x44, 0x39, 0xE8 }, 3);
+	emitBytes(dynarec, (uint8_t[]){ 0x0F, 0x83 }, 2);
+	patch(dynarec->emitPtr, dynarec->exitStub);
+	dynarec->emitPtr += 4;
+
+	// add qword [rbx + instructions], count
+	emitBytes(dynarec, (uint8_t[]){ 0x48, 0x81, 0x83 }, 3);
+	emit32(dynarec, OFFSET(instructions));
+	uint8_t *countSite = dynarec->emitPtr;
+	emit32(dynarec, 0);
+
+	// add r12d, cycles of the inlined instructions
+	emitBytes(dynarec, (uint8_t[]){ 0x41, 0x81, 0xC4 }, 3);
+	uint8_t *cyclesSite = dynarec->emitPtr;
+	emit32(dynarec, 0);
+
+	uint16_t address = pc;
+	uint32_t count = 0;
+	uint32_t maxCycles = 0;
+	uint32_t inlineCycles = 0;
+
+	for (;;) {
+		const decoded_t *decoded = getDecoded(romCache, address);
+
+		if (decoded == NULL || address >= romCache->size ||
+			count == MAX_BLOCK_INSTRUCTIONS) {
+			emitStoreImm16(dynarec, OFFSET(PC), address);
+			emitJump(dynarec, address);
+			break;
+		}
+
+		const opcode_info_t *info = &opcodeInfo[decoded->opcode];
+		uint8_t instruction = info->instruction;
+		uint16_t next = address + info->length;
+
+		count++;
+		maxCycles += info->cycles;
+
+		if (instruction == INSTR_JMP) {
+			inlineCycles += info->cycles;
+			emitStoreImm16(dynarec, OFFSET(PC), decoded->operand);
+			emitJump(dynarec, decoded->operand);
+			break;
+		}
+
+		if (emitInline(dynarec, decoded->opcode, decoded->operand)) {
+			inlineCycles += info->cycles;
+			address = next;
+			continue;
+		}
+
+		// The handler reads its operands relative to PC
+		emitStoreImm16(dynarec, OFFSET(PC), address);
+		emitHandlerCall(dynarec, decoded->opcode);
+
+		if (instruction == INSTR_JMPC || instruction == INSTR_CALLC) {
+			// Conditional jumps take the same time either way
+			if (instruction == INSTR_CALLC) {
+				maxCycles += 6;
+			}
+
+			emitJumpIfPC(dynarec, decoded->operand);
+			emitJump(dynarec, next);
+			break;
+		} else if (instruction == INSTR_CALL) {
+			emitJump(dynarec, decoded->operand);
+			break;
+		} else if (instruction == INSTR_RETC) {
+			maxCycles += 6;
+			emitJumpIfPC(dynarec, next);
+			emitExit(dynarec);
+			break;
+		} else if (instruction == INSTR_RET ||
+				   instruction == INSTR_PCHL || instruction == INSTR_RST ||
+				   instruction == INSTR_HLT || instruction == INSTR_EI) {
+			// Unknown target, or an interrupt may be accepted after EI
+			emitExit(dynarec);
+			break;
+		}
+
+		address = next;
+	}
+
+	memcpy(maxCyclesSite, &maxCycles, sizeof(maxCycles));
+	memcpy(countSite, &count, sizeof(count));
+	memcpy(cyclesSite, &inlineCycles, sizeof(inlineCycles));
+
+	dynarec->blocks[pc].entry = entry;
+	dynarec->blocks[pc].maxCycles = maxCycles;
+	resolveLinks(dynarec, pc);
+
+	return &dynarec->blocks[pc];
+}
+
+dynarec_t *createDynarec(void)
+{
+	dynarec_t *dynarec = calloc(1, sizeof(dynarec_t));
+
+	if (dynarec == NULL) {
+		perror("Dynarec: could not allocate the block table");
+		return NULL;
+	}
+
+	dynarec->code = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (dynarec->code == MAP_FAILED) {
+		perror("Dynarec: could not allocate the code buffer");
+		free(dynarec);
+		return NULL;
+	}
+
+	dynarec->emitPtr = dynarec->code;
+
+	// uint32_t enterCode(cpu, cycles, budget, entry)
+	dynarec->enterCode = (uint32_t(*)(cpu_t *, uint32_t, uint32_t,
+									  const uint8_t *))(uintptr_t)
+							 dynarec->emitPtr;
+	emitBytes(dynarec, (uint8_t[]){ 0x53 }, 1); // push rbx
+	emitBytes(dynarec, (uint8_t[]){ 0x41, 0x54 }, 2); // push r12
+	emitBytes(dynarec, (uint8_t[]){ 0x41, 0x55 }, 2); // push r13
+	emitBytes(dynarec, (uint8_t[]){ 0x48, 0x89, 0xFB }, 3); // mov rbx, rdi
+	emitBytes(dynarec, (uint8_t[]){ 0x41, 0x89, 0xF4 }, 3); // mov r12d, esi
+	emitBytes(dynarec, (uint8_t[]){ 0x41, 0x89, 0xD5 }, 3); // mov r13d, edx
+	emitBytes(dynarec, (uint8_t[]){ 0xFF, 0xE1 }, 2); // jmp rcx
+
+	dynarec->exitStub = dynarec->emitPtr;
+	emitBytes(dynarec, (uint8_t[]){ 0x44, 0x89, 0xE0 }, 3); // mov eax, r12d
+	emitBytes(dynarec, (uint8_t[]){ 0x41, 0x5D }, 2); // pop r13
+	emitBytes(dynarec, (uint8_t[]){ 0x41, 0x5C }, 2); // pop r12
+	emitBytes(dynarec, (uint8_t[]){ 0x5B }, 1); // pop rbx
+	emitBytes(dynarec, (uint8_t[]){ 0xC3 }, 1); // ret
+
+	dynarec->blocksStart = dynarec->emitPtr;
+	flushBlocks(dynarec);
+
+	return dynarec;
+}
+
+void destroyDynarec(dynarec_t *dynarec)
+{
+	if (dynarec == NULL) {
+		return;
+	}
+
+	munmap(dynarec->code, CODE_SIZE);
+	free(dynarec);
+}
+
+uint32_t runDynarec(dynarec_t *dynarec, cpu_t *cpu, uint32_t budget)
+{
+	const rom_cache_t *romCache = &cpu->machine->bus.romCache;
+	uint32_t cycles = 0;
+
+	// The translated code is based on the old ROM
+	if (dynarec->romHash != romCache->hash) {
+		flushBlocks(dynarec);
+		dynarec->romHash = romCache->hash;
+	}
+
+	while (cycles < budget) {
+		uint16_t pc = cpu->PC;
+		block_t *block = NULL;
+
+		if (!(cpu->interrupt_enabled && cpu->interrupt) &&
+			pc < romCache->size) {
+			block = dynarec->blocks[pc].entry ?
+						&dynarec->blocks[pc] :
+						compileBlock(dynarec, romCache, pc);
+		}
+
+		// Interpret whatever can't run as a whole block
+		if (block == NULL || cycles + block->maxCycles >= budget) {
+			cycles += step(cpu);
+			continue;
+		}
+
+		cycles = dynarec->enterCode(cpu, cycles, budget, block->entry);
+	}
+
+	return cycles;
+}
+
+#endif
@@ -3,6 +3,40 @@
 #include <stdint.h>
 #include <stdio.h>
 
+// Expands X(i) for i = 0 ... 255 (or 511)
+#define TABLE4(X, i) X(i), X((i) + 1), X((i) + 2), X((i) + 3)
+#define TABLE16(X, i) \
+	TABLE4(X, i), TABLE4(X, (i) + 4), TABLE4(X, (i) + 8), TABLE4(X, (i) + 12)
+#define TABLE64(X, i)                                          \
+	TABLE16(X, i), TABLE16(X, (i) + 16), TABLE16(X, (i) + 32), \
+		TABLE16(X, (i) + 48)
+#define TABLE256(X, i)                                         \
+	TABLE64(X, i), TABLE64(X, (i) + 64), TABLE64(X, (i) + 128), \
+		TABLE64(X, (i) + 192)
+#define TABLE512(X) TABLE256(X, 0), TABLE256(X, 256)
+
+// 1 if the number of set bits is odd
+#define ODD_PARITY(v)                                                     \
+	(((v) ^ (v) >> 1 ^ (v) >> 2 ^ (v) >> 3 ^ (v) >> 4 ^ (v) >> 5 ^ (v) >> 6 ^ \
+	  (v) >> 7) &                                                           \
+	 1)
+
+#define SZP(v)                                         \
+	(((v) & 0x80 ? SIGN : 0) | ((v) == 0 ? ZERO : 0) | \
+	 (ODD_PARITY(v) ? 0 : PARITY))
+
+// Same results as handle_halfcarry8, see below. The 8080 subtracts by adding
+// the complement, so the Auxiliary Carry is set if the low nibble does not
+// borrow.
+#define HALFCARRY_ADD(i)                                                  \
+	((((i) >> 4 & 0x0F) + ((i) & 0x0F) + ((i) >> 8)) > 0x0F ? AUXCARRY : 0)
+#define HALFCARRY_SUB(i)                                                  \
+	((((i) >> 4 & 0x0F) - ((i) & 0x0F) - ((i) >> 8)) >= 0 ? AUXCARRY : 0)
+
+const uint8_t szp_table[256] = { TABLE256(SZP, 0) };
+const uint8_t halfcarry_add_table[512] = { TABLE512(HALFCARRY_ADD) };
+const uint8_t halfcarry_sub_table[512] = { TABLE512(HALFCARRY_SUB) };
+
 void set_flag(cpu_t *cpu, enum FLAGS flag)
 {
 	cpu->AF.lowByte |= flag;
@@ -15,19 +49,7 @@ void clear_flag(cpu_t *cpu, enum FLAGS flag)
 
 void handle_parity(cpu_t *cpu, uint8_t byte)
 {
-	uint8_t count = 0;
-
-	for (int i = 0; i < 8; i++) {
-		if (byte & (1 << i)) {
-			count++;
-		}
-	}
-
-	if (count % 2 == 0) {
-		set_flag(cpu, PARITY);
-	} else {
-		clear_flag(cpu, PARITY);
-	}
+	update_flags(cpu, PARITY, szp_table[byte] & PARITY);
 }
 
 void handle_sign(cpu_t *cpu, uint8_t byte)
@@ -49,25 +71,22 @@ void handle_zero(cpu_t *cpu, uint8_t byte)
 }
 
 void handle_halfcarry8(cpu_t *cpu, uint8_t byte1, uint8_t byte2,
-					   uint8_t isSubtraction)
+					   uint8_t carry, uint8_t isSubtraction)
 {
-	// uint8_t aux = ((cpu->AF.highByte & 0x0F) + (value & 0x0F)) > 0x0F;
-	// uint8_t aux = ((cpu->AF.highByte & 0x0F) - ((value + carry) & 0x0F)) < 0x0F;
-
-	if ((isSubtraction && (byte1 & 0x0F) - (byte2 & 0x0F) < 0x0F) ||
-
-		(!isSubtraction && ((byte1 & 0x0F) + (byte2 & 0x0F)) > 0x0F)) {
+	// Subtractions set it if the low nibble does not borrow
+	if ((isSubtraction && (byte1 & 0x0F) - (byte2 & 0x0F) - carry >= 0) ||
+		(!isSubtraction && (byte1 & 0x0F) + (byte2 & 0x0F) + carry > 0x0F)) {
 		set_flag(cpu, AUXCARRY);
 	} else {
 		clear_flag(cpu, AUXCARRY);
 	}
 }
 
-void handle_carry8(cpu_t *cpu, uint8_t byte1, uint8_t byte2,
+void handle_carry8(cpu_t *cpu, uint8_t byte1, uint8_t byte2, uint8_t carry,
 				   uint8_t isSubtraction)
 {
-	if ((isSubtraction && byte1 < byte2) ||
-		(!isSubtraction && byte1 + byte2 > 0xFF)) {
+	if ((isSubtraction && byte1 < byte2 + carry) ||
+		(!isSubtraction && byte1 + byte2 + carry > 0xFF)) {
 		set_flag(cpu, CARRY);
 	} else {
 		clear_flag(cpu, CARRY);
@@ -84,3 +103,45 @@ void handle_carry16(cpu_t *cpu, uint16_t word1, uint16_t word2,
 		clear_flag(cpu, CARRY);
 	}
 }
+
+#ifdef LAZY_FLAGS_VALIDATE
+uint8_t eager_flags(uint8_t flags, const lazy_flags_t *lazy)
+{
+	cpu_t cpu;
+	cpu.AF.lowByte = flags;
+
+	switch (lazy->op) {
+	case LAZY_ADD:
+	case LAZY_SUB: {
+		uint8_t isSubtraction = lazy->op == LAZY_SUB;
+		handle_carry8(&cpu, lazy->byte1, lazy->byte2, lazy->carry,
+					  isSubtraction);
+		handle_halfcarry8(&cpu, lazy->byte1, lazy->byte2, lazy->carry,
+						  isSubtraction);
+		break;
+	}
+	case LAZY_INR:
+	case LAZY_DCR:
+		handle_halfcarry8(&cpu, lazy->byte1, 1, 0, lazy->op == LAZY_DCR);
+		break;
+	case LAZY_ANA:
+		if ((lazy->byte1 | lazy->byte2) & 0x08) {
+			set_flag(&cpu, AUXCARRY);
+		} else {
+			clear_flag(&cpu, AUXCARRY);
+		}
+		clear_flag(&cpu, CARRY);
+		break;
+	default:
+		clear_flag(&cpu, CARRY);
+		clear_flag(&cpu, AUXCARRY);
+		break;
+	}
+
+	handle_zero(&cpu, lazy->result);
+	handle_sign(&cpu, lazy->result);
+	handle_parity(&cpu, lazy->result);
+
+	return cpu.AF.lowByte;
+}
+#endif
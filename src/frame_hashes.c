@@ -0,0 +1,165 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bus.h"
+#include "frame_hashes.h"
+#include "machine.h"
+
+// Like FNV-1a, but on 4 independent 8 byte lanes as hashBytes() is too slow
+// to run on every frame. size has to be a multiple of 32.
+static void hashLanes(uint64_t lanes[4], const uint8_t *data, size_t size)
+{
+	for (size_t i = 0; i < size; i += 32) {
+		for (int lane = 0; lane < 4; lane++) {
+			uint64_t word;
+			memcpy(&word, data + i + lane * 8, sizeof(word));
+			lanes[lane] ^= word;
+			lanes[lane] *= 0x100000001B3ULL;
+			lanes[lane] ^= lanes[lane] >> 32;
+		}
+	}
+}
+
+uint64_t hashFrame(const machine_t *machine)
+{
+	uint64_t lanes[4] = { 0xCBF29CE484222325ULL, 1, 2, 3 };
+	uint64_t hash = 0;
+
+	hashLanes(lanes, machine->memory.ram, sizeof(machine->memory.ram));
+	hashLanes(lanes, machine->memory.vram, sizeof(machine->memory.vram));
+
+	for (int lane = 0; lane < 4; lane++) {
+		hash = (hash ^ lanes[lane]) * 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+void initFrameHashes(frame_hashes_t *trace)
+{
+	trace->hashes = NULL;
+	trace->count = 0;
+	trace->capacity = 0;
+	trace->frame = 0;
+	trace->verify = 0;
+	trace->diverged = 0;
+	trace->firstDivergence = 0;
+}
+
+void loadFrameHashes(frame_hashes_t *trace, const machine_t *machine,
+					 const char *path)
+{
+	frame_hashes_header_t header;
+	FILE *file = fopen(path, "rb");
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not open frame hashes: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	if (1 != fread(&header, sizeof(header), 1, file) ||
+		header.magic != FRAME_HASHES_MAGIC ||
+		header.version != FRAME_HASHES_VERSION) {
+		fprintf(stderr, "Not a frame hash file: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	if (header.romHash != machine->bus.romCache.hash) {
+		fprintf(stderr, "Frame hashes were recorded with a different ROM: %s\n",
+				path);
+		exit(EXIT_FAILURE);
+	}
+
+	initFrameHashes(trace);
+	trace->verify = 1;
+	trace->count = header.frames;
+	trace->capacity = header.frames;
+	trace->hashes = malloc((header.frames + 1) * sizeof(uint64_t));
+
+	if (NULL == trace->hashes) {
+		fprintf(stderr, "Could not allocate the frame hashes!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (header.frames != fread(trace->hashes, sizeof(uint64_t), header.frames,
+							   file)) {
+		fprintf(stderr, "Frame hashes are truncated: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	fclose(file);
+}
+
+void checkFrameHash(frame_hashes_t *trace, const machine_t *machine)
+{
+	uint64_t hash = hashFrame(machine);
+	uint64_t frame = trace->frame++;
+
+	if (trace->verify) {
+		// Running longer than the trace is a divergence as well
+		if (!trace->diverged &&
+			(frame >= trace->count || trace->hashes[frame] != hash)) {
+			trace->diverged = 1;
+			trace->firstDivergence = frame;
+		}
+
+		return;
+	}
+
+	if (trace->count == trace->capacity) {
+		trace->capacity = trace->capacity ? trace->capacity * 2 : 4096;
+		trace->hashes =
+			realloc(trace->hashes, trace->capacity * sizeof(uint64_t));
+
+		if (NULL == trace->hashes) {
+			fprintf(stderr, "Could not allocate the frame hashes!\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	trace->hashes[trace->count++] = hash;
+}
+
+uint8_t frameHashesMatch(const frame_hashes_t *trace)
+{
+	return !trace->diverged && trace->frame == trace->count;
+}
+
+uint8_t saveFrameHashes(const frame_hashes_t *trace, const machine_t *machine,
+						const char *path)
+{
+	frame_hashes_header_t header = {
+		.magic = FRAME_HASHES_MAGIC,
+		.version = FRAME_HASHES_VERSION,
+		.reserved = 0,
+		.romHash = machine->bus.romCache.hash,
+		.frames = trace->count,
+	};
+
+	FILE *file = fopen(path, "wb");
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not create frame hashes: %s\n", path);
+		return 0;
+	}
+
+	uint8_t result =
+		1 == fwrite(&header, sizeof(header), 1, file) &&
+		trace->count == fwrite(trace->hashes, sizeof(uint64_t), trace->count,
+							   file);
+	fclose(file);
+
+	if (!result) {
+		fprintf(stderr, "Failed to write frame hashes: %s\n", path);
+	}
+
+	return result;
+}
+
+void freeFrameHashes(frame_hashes_t *trace)
+{
+	free(trace->hashes);
+	trace->hashes = NULL;
+}
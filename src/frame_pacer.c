@@ -0,0 +1,176 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "frame_pacer.h"
+#include "host_time.h"
+
+// Bounds of the time spent spinning before a deadline
+#define MIN_SPIN_NS 200000
+#define MAX_SPIN_NS 4000000
+
+static uint32_t *allocateHistogram(void)
+{
+	uint32_t *histogram = calloc(PACER_HISTOGRAM_US + 1, sizeof(uint32_t));
+
+	if (NULL == histogram) {
+		fprintf(stderr, "Could not allocate the frame pacer statistics!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return histogram;
+}
+
+static void countTime(uint32_t *histogram, uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	histogram[us < PACER_HISTOGRAM_US ? us : PACER_HISTOGRAM_US]++;
+}
+
+// The time in us (the lower end of its bucket) at or below which percent %
+// of the count times are
+static uint32_t getPercentile(const uint32_t *histogram, uint64_t count,
+							  uint32_t percent)
+{
+	uint64_t rank = (count * percent + 99) / 100;
+	uint64_t counted = 0;
+
+	for (uint32_t us = 0; us < PACER_HISTOGRAM_US; us++) {
+		counted += histogram[us];
+
+		if (counted >= rank) {
+			return us;
+		}
+	}
+
+	return PACER_HISTOGRAM_US;
+}
+
+// Move the deadline one frame period on, the fraction of a ns is kept
+static void nextDeadline(frame_pacer_t *pacer)
+{
+	pacer->deadline += FRAME_NS_NUMERATOR / FRAME_NS_DENOMINATOR;
+	pacer->remainder += FRAME_NS_NUMERATOR % FRAME_NS_DENOMINATOR;
+
+	if (pacer->remainder >= FRAME_NS_DENOMINATOR) {
+		pacer->remainder -= FRAME_NS_DENOMINATOR;
+		pacer->deadline++;
+	}
+}
+
+// Sleep until the given time, it may end later
+static void sleepUntil(uint64_t ns)
+{
+	struct timespec time = { .tv_sec = ns / 1000000000ULL,
+							 .tv_nsec = ns % 1000000000ULL };
+
+	// Restart it if a signal interrupted it, the time is absolute
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL) ==
+		   EINTR) {
+	}
+}
+
+void initFramePacer(frame_pacer_t *pacer)
+{
+	pacer->lastFrame = getTimeNS();
+	pacer->deadline = pacer->lastFrame;
+	pacer->remainder = 0;
+	pacer->spinNS = 1000000;
+	pacer->frameTimes = allocateHistogram();
+	pacer->jitter = allocateHistogram();
+	pacer->maxFrameNS = 0;
+	pacer->maxJitterNS = 0;
+	pacer->frames = 0;
+	pacer->late = 0;
+	pacer->resyncs = 0;
+
+	nextDeadline(pacer);
+}
+
+void waitForFrame(frame_pacer_t *pacer)
+{
+	uint64_t now = getTimeNS();
+
+	if (now > pacer->deadline) {
+		pacer->late++;
+	} else {
+		if (pacer->deadline - now > pacer->spinNS) {
+			uint64_t wakeUp = pacer->deadline - pacer->spinNS;
+
+			sleepUntil(wakeUp);
+			now = getTimeNS();
+
+			// Leave twice the latest wake up for spinning, or slowly less
+			uint64_t overslept = now > wakeUp ? now - wakeUp : 0;
+
+			if (overslept * 2 > pacer->spinNS) {
+				pacer->spinNS = overslept * 2;
+			} else {
+				pacer->spinNS -= pacer->spinNS / 16;
+			}
+
+			if (pacer->spinNS < MIN_SPIN_NS) {
+				pacer->spinNS = MIN_SPIN_NS;
+			} else if (pacer->spinNS > MAX_SPIN_NS) {
+				pacer->spinNS = MAX_SPIN_NS;
+			}
+		}
+
+		while (now < pacer->deadline) {
+			now = getTimeNS();
+		}
+	}
+
+	uint64_t frameNS = now - pacer->lastFrame;
+	uint64_t jitterNS = now - pacer->deadline;
+
+	countTime(pacer->frameTimes, frameNS);
+	countTime(pacer->jitter, jitterNS);
+	pacer->maxFrameNS = frameNS > pacer->maxFrameNS ? frameNS :
+													  pacer->maxFrameNS;
+	pacer->maxJitterNS = jitterNS > pacer->maxJitterNS ? jitterNS :
+														 pacer->maxJitterNS;
+	pacer->lastFrame = now;
+	pacer->frames++;
+
+	nextDeadline(pacer);
+
+	// More than a frame behind, catching up would run frames back to back
+	if (pacer->deadline <= now) {
+		pacer->deadline = now;
+		pacer->remainder = 0;
+		pacer->resyncs++;
+		nextDeadline(pacer);
+	}
+}
+
+void printFramePacerStats(const frame_pacer_t *pacer)
+{
+	if (pacer->frames == 0) {
+		return;
+	}
+
+	printf("Frame pacing: %llu frames at %.2f Hz, %llu late, %llu resyncs\n",
+		   (unsigned long long)pacer->frames,
+		   (double)CPU_CLOCK / CYCLES_PER_FRAME,
+		   (unsigned long long)pacer->late,
+		   (unsigned long long)pacer->resyncs);
+	printf("  Frame time: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+		   getPercentile(pacer->frameTimes, pacer->frames, 50) / 1e3,
+		   getPercentile(pacer->frameTimes, pacer->frames, 99) / 1e3,
+		   pacer->maxFrameNS / 1e6);
+	printf("  Jitter:     p50 %u us, p99 %u us, max %.0f us\n",
+		   getPercentile(pacer->jitter, pacer->frames, 50),
+		   getPercentile(pacer->jitter, pacer->frames, 99),
+		   pacer->maxJitterNS / 1e3);
+}
+
+void freeFramePacer(frame_pacer_t *pacer)
+{
+	free(pacer->frameTimes);
+	free(pacer->jitter);
+}
@@ -0,0 +1,213 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cpu.h"
+#include "frame_hashes.h"
+#include "headless.h"
+#include "host_time.h"
+#include "machine.h"
+#include "movie.h"
+#include "rewind.h"
+#include "rom_cache.h"
+#include "runahead.h"
+#include "savestate.h"
+#include "scheduler.h"
+
+uint32_t emulateFrameHeadless(cpu_t *cpu)
+{
+	machine_t *machine = cpu->machine;
+	uint64_t start = machine->scheduler.now;
+
+	while (runUntilEvent(machine) != EVENT_VBLANK) {
+	}
+
+	return machine->scheduler.now - start;
+}
+
+static void runAheadFrame(machine_t *machine, uint8_t draw)
+{
+	(void)draw; // Nothing is drawn anyway
+	emulateFrameHeadless(&machine->cpu);
+}
+
+// Step back through the whole history, returns the ns it took per frame
+static double measureRewind(machine_t *machine, rewind_t *history)
+{
+	uint64_t frames = 0;
+	uint64_t start = getTimeNS();
+
+	while (rewindFrame(history, machine)) {
+		frames++;
+	}
+
+	return frames ? (double)(getTimeNS() - start) / frames : 0;
+}
+
+static uint8_t reportFrameHashes(const frame_hashes_t *trace,
+								 uint64_t hashTime)
+{
+	printf("  Frame hashes:    %.0f ns/frame\n",
+		   trace->frame ? (double)hashTime / trace->frame : 0);
+
+	if (!trace->verify) {
+		return 1;
+	}
+
+	if (frameHashesMatch(trace)) {
+		printf("  Golden trace:    all %llu frames match\n",
+			   (unsigned long long)trace->count);
+		return 1;
+	}
+
+	// Counted from 1 like "all N frames", firstDivergence is an index
+	if (trace->diverged) {
+		printf("  Golden trace:    DIVERGED at frame %llu of %llu\n",
+			   (unsigned long long)trace->firstDivergence + 1,
+			   (unsigned long long)trace->count);
+	} else {
+		printf("  Golden trace:    only %llu of %llu frames were run\n",
+			   (unsigned long long)trace->frame,
+			   (unsigned long long)trace->count);
+	}
+
+	return 0;
+}
+
+// cycles: all cycles the machine emulated
+static void reportIdleSkip(const machine_t *machine, uint64_t cycles)
+{
+	const rom_cache_t *romCache = &machine->bus.romCache;
+	const idle_skip_t *skip = &machine->idleSkip;
+
+	if (!skip->enabled) {
+		printf("  Idle skip:       off\n");
+		return;
+	}
+
+	printf("  Idle skip:       %.1f%% of the cycles in %u loops\n",
+		   cycles ? 100.0 * skip->cycles / cycles : 0,
+		   romCache->idleLoopCount);
+
+	for (uint8_t i = 0; i < romCache->idleLoopCount; i++) {
+		const idle_loop_t *loop = &romCache->idleLoops[i];
+
+		printf("    %04X-%04X  %2u cycles  %10llu skips\n", loop->start,
+			   loop->jump, loop->cycles, (unsigned long long)skip->hits[i]);
+	}
+}
+
+// Set up the next frame, returns 0 once the run is over
+static uint8_t nextFrame(const headless_config_t *config, machine_t *machine,
+						 uint64_t frames, uint64_t cycles)
+{
+	if (config->movie) {
+		return playInput(config->movie, machine);
+	}
+
+	if (config->cycles) {
+		return cycles < config->cycles;
+	}
+
+	return frames < config->frames;
+}
+
+uint8_t runHeadless(machine_t *machine, const headless_config_t *config)
+{
+	cpu_t *cpu = &machine->cpu;
+	uint64_t frames = 0;
+	uint64_t cycles = 0;
+	uint64_t instructions = cpu->instructions;
+	uint64_t recordTime = 0;
+	uint64_t hashTime = 0;
+	rewind_t history;
+	runahead_t runahead;
+
+	initRunAhead(&runahead, config->runAhead);
+
+	if (config->rewind) {
+		initRewind(&history, REWIND_FRAMES, REWIND_BUFFER_SIZE);
+	}
+
+	uint64_t start = getTimeNS();
+
+	while (nextFrame(config, machine, frames, cycles)) {
+		cycles += emulateFrameHeadless(cpu);
+		frames++;
+
+		if (config->hashes) {
+			uint64_t hashStart = getTimeNS();
+			checkFrameHash(config->hashes, machine);
+			hashTime += getTimeNS() - hashStart;
+		}
+
+		if (config->rewind) {
+			uint64_t recordStart = getTimeNS();
+			recordFrame(&history, machine);
+			recordTime += getTimeNS() - recordStart;
+		}
+
+		runAhead(&runahead, machine, runAheadFrame);
+	}
+
+	// Only the emulation is measured, the rest is printed below
+	uint64_t elapsed =
+		getTimeNS() - start - recordTime - hashTime - runahead.totalNS;
+	instructions = cpu->instructions - instructions;
+	double seconds = elapsed / 1e9;
+
+	if (elapsed == 0 || instructions == 0) {
+		fprintf(stderr, "Headless run too short to measure!\n");
+		return 0;
+	}
+
+	printf("Headless run finished:\n");
+	printf("  Frames:          %llu\n", (unsigned long long)frames);
+	printf("  Cycles:          %llu\n", (unsigned long long)cycles);
+	printf("  Instructions:    %llu\n", (unsigned long long)instructions);
+	printf("  Host time:       %.3f s\n", seconds);
+	printf("  Emulated MHz:    %.2f\n", cycles / seconds / 1e6);
+	printf("  Frames/s:        %.1f\n", frames / seconds);
+	printf("  ns/instruction:  %.2f\n", (double)elapsed / instructions);
+
+	if (config->movie) {
+		// Has to stay the same if only the speed of the emulator changed
+		savestate_t state;
+		snapshotState(machine, &state);
+		printf("  Final state:     %016llX\n",
+			   (unsigned long long)hashBytes((const uint8_t *)&state,
+											 sizeof(state)));
+	}
+
+	// The frames run ahead skip as well
+	reportIdleSkip(machine, cycles * (1 + runahead.frames));
+
+	uint8_t match = 1;
+
+	if (config->hashes) {
+		match = reportFrameHashes(config->hashes, hashTime);
+	}
+
+	if (config->rewind) {
+		rewind_stats_t stats = getRewindStats(&history);
+		double recordNS = (double)recordTime / frames;
+
+		printf("  Rewind history:  %u frames (%.1f s) in %zu bytes, %zu KB "
+			   "allocated\n",
+			   stats.frames, stats.frames / 60.0, stats.bytesUsed,
+			   stats.memory / 1024);
+		printf("  Rewind record:   %.0f ns/frame (%.2f%% of the emulation, "
+			   "%.3f%% of a 60 Hz frame)\n",
+			   recordNS, recordNS * frames / elapsed * 100,
+			   recordNS / 1e9 * 60 * 100);
+		printf("  Rewind step:     %.0f ns/frame\n",
+			   measureRewind(machine, &history));
+
+		freeRewind(&history);
+	}
+
+	printRunAheadStats(&runahead);
+
+	return match;
+}
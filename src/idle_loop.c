@@ -0,0 +1,250 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "idle_loop.h"
+#include "opcode_info.h"
+#include "rom_cache.h"
+
+// The registers an instruction reads and writes, one bit each. The Carry
+// is separate from the other flags, INR and DCR keep it.
+enum REGISTER {
+	R_A = 0x001,
+	R_B = 0x002,
+	R_C = 0x004,
+	R_D = 0x008,
+	R_E = 0x010,
+	R_H = 0x020,
+	R_L = 0x040,
+	R_F = 0x080, // Sign, Zero, Auxiliary Carry, Parity
+	R_CY = 0x100 // Carry
+};
+
+// Registers of an operand, M is the memory at HL. 0 for the stack
+// pointer, which the loops may not use.
+static uint16_t registersOf(uint8_t operand)
+{
+	switch (operand) {
+	case OPERAND_A:
+		return R_A;
+	case OPERAND_B:
+		return R_B;
+	case OPERAND_C:
+		return R_C;
+	case OPERAND_D:
+		return R_D;
+	case OPERAND_E:
+		return R_E;
+	case OPERAND_H:
+		return R_H;
+	case OPERAND_L:
+		return R_L;
+	case OPERAND_M:
+	case OPERAND_HL:
+		return R_H | R_L;
+	case OPERAND_BC:
+		return R_B | R_C;
+	case OPERAND_DE:
+		return R_D | R_E;
+	default:
+		return 0;
+	}
+}
+
+// Set the registers the instruction reads and writes. Returns 0 if it may
+// not be in an idle loop: it writes memory, does I/O, uses the stack,
+// branches or changes the interrupts.
+static uint8_t getEffects(const opcode_info_t *info, uint16_t *reads,
+						  uint16_t *writes)
+{
+	uint16_t x = registersOf(info->x);
+	uint16_t y = registersOf(info->y);
+
+	*reads = 0;
+	*writes = 0;
+
+	switch (info->instruction) {
+	case INSTR_NOP:
+		break;
+	case INSTR_MOV:
+		if (info->x == OPERAND_M) {
+			return 0;
+		}
+		*reads = y;
+		*writes = x;
+		break;
+	case INSTR_MVI:
+		if (info->x == OPERAND_M) {
+			return 0;
+		}
+		*writes = x;
+		break;
+	case INSTR_LXI:
+		if (!x) {
+			return 0;
+		}
+		*writes = x;
+		break;
+	case INSTR_LDA:
+		*writes = R_A;
+		break;
+	case INSTR_LDAX:
+		*reads = x;
+		*writes = R_A;
+		break;
+	case INSTR_LHLD:
+		*writes = R_H | R_L;
+		break;
+	case INSTR_ADD:
+	case INSTR_SUB:
+	case INSTR_ANA:
+	case INSTR_XRA:
+	case INSTR_ORA:
+	case INSTR_ADI:
+	case INSTR_SUI:
+	case INSTR_ANI:
+	case INSTR_XRI:
+	case INSTR_ORI:
+		*reads = R_A | x;
+		*writes = R_A | R_F | R_CY;
+		break;
+	case INSTR_ADC:
+	case INSTR_SBB:
+	case INSTR_ACI:
+	case INSTR_SBI:
+		*reads = R_A | R_CY | x;
+		*writes = R_A | R_F | R_CY;
+		break;
+	case INSTR_CMP:
+	case INSTR_CPI:
+		*reads = R_A | x;
+		*writes = R_F | R_CY;
+		break;
+	case INSTR_INR:
+	case INSTR_DCR:
+		if (info->x == OPERAND_M) {
+			return 0;
+		}
+		*reads = x;
+		*writes = x | R_F;
+		break;
+	case INSTR_INX:
+	case INSTR_DCX:
+		if (!x) {
+			return 0;
+		}
+		*reads = x;
+		*writes = x;
+		break;
+	case INSTR_DAD:
+		if (!x) {
+			return 0;
+		}
+		*reads = R_H | R_L | x;
+		*writes = R_H | R_L | R_CY;
+		break;
+	case INSTR_RLC:
+	case INSTR_RRC:
+		*reads = R_A;
+		*writes = R_A | R_CY;
+		break;
+	case INSTR_RAL:
+	case INSTR_RAR:
+		*reads = R_A | R_CY;
+		*writes = R_A | R_CY;
+		break;
+	case INSTR_DAA:
+		*reads = R_A | R_F | R_CY;
+		*writes = R_A | R_F | R_CY;
+		break;
+	case INSTR_CMA:
+		*reads = R_A;
+		*writes = R_A;
+		break;
+	case INSTR_STC:
+		*writes = R_CY;
+		break;
+	case INSTR_CMC:
+		*reads = R_CY;
+		*writes = R_CY;
+		break;
+	case INSTR_XCHG:
+		*reads = R_D | R_E | R_H | R_L;
+		*writes = R_D | R_E | R_H | R_L;
+		break;
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
+// Check the loop from start to the conditional jump back at jump, fills in
+// loop if it is an idle loop
+static uint8_t isIdleLoop(const uint8_t *rom, uint16_t start, uint16_t jump,
+						  idle_loop_t *loop)
+{
+	uint16_t inputs = 0; // Read before the loop wrote them
+	uint16_t written = 0;
+	uint16_t address = start;
+
+	*loop = (idle_loop_t){ start, jump, 0, 0 };
+
+	while (address < jump) {
+		const opcode_info_t *info = &opcodeInfo[rom[address]];
+		uint16_t reads;
+		uint16_t writes;
+
+		if (!getEffects(info, &reads, &writes)) {
+			return 0;
+		}
+
+		inputs |= reads & ~written;
+		written |= writes;
+		loop->cycles += info->cycles;
+		loop->instructions++;
+		address += info->length;
+	}
+
+	// The body has to end right at the jump, which reads a flag
+	uint8_t condition = opcodeInfo[rom[jump]].x;
+	uint16_t flag = R_F;
+
+	if (condition == OPERAND_C || condition == OPERAND_NC) {
+		flag = R_CY;
+	}
+
+	inputs |= flag & ~written;
+	loop->cycles += opcodeInfo[rom[jump]].cycles;
+	loop->instructions++;
+
+	// Otherwise the next iteration could do something else
+	return address == jump && !(inputs & written);
+}
+
+uint8_t findIdleLoops(const uint8_t *rom, idle_loop_t *loops)
+{
+	uint8_t count = 0;
+
+	for (uint16_t jump = 0; jump < ROM_CACHE_SIZE; jump++) {
+		uint16_t start = rom[jump + 1] | rom[jump + 2] << 8;
+
+		if (opcodeInfo[rom[jump]].instruction != INSTR_JMPC ||
+			start > jump || jump - start > IDLE_LOOP_MAX_LENGTH) {
+			continue;
+		}
+
+		if (count < IDLE_LOOPS_MAX &&
+			isIdleLoop(rom, start, jump, &loops[count])) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void initIdleSkip(idle_skip_t *skip)
+{
+	skip->enabled = 1;
+	skip->cycles = 0;
+	memset(skip->hits, 0, sizeof(skip->hits));
+}
@@ -1,11 +1,12 @@
 
-#include "cpu.h"
+#include "machine.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_events.h>
 #include <stdint.h>
 #include "input_handler.h"
+#include "renderer.h"
 
-void handle_input(cpu_t *cpu)
+void handle_input(machine_t *machine)
 {
 	uint8_t p1_input = 0;
 	uint8_t p2_input = 0;
@@ -30,20 +31,39 @@ void handle_input(cpu_t *cpu)
 	p2_input |= (keystate[SDL_SCANCODE_A] << 5); // 2P Left -> Port 2, Bit 5
 	p2_input |= (keystate[SDL_SCANCODE_D] << 6); // 2P Right -> Port 2, Bit 6
 
-	// Write the calculated inputs to the CPU ports
-	cpu->io_port[1] = p1_input;
-	cpu->io_port[2] = p2_input;
+	// Write the calculated inputs to the input ports
+	machine->io_port[1] = p1_input;
+	machine->io_port[2] = p2_input;
 }
 
-void handle_events(cpu_t *cpu, uint8_t *running)
+uint8_t getRewindSpeed(void)
+{
+	const uint8_t *keystate = SDL_GetKeyboardState(NULL);
+
+	// Backspace -> one frame back per frame, with Shift -> four
+	if (!keystate[SDL_SCANCODE_BACKSPACE]) {
+		return 0;
+	}
+
+	if (keystate[SDL_SCANCODE_LSHIFT] || keystate[SDL_SCANCODE_RSHIFT]) {
+		return 4;
+	}
+
+	return 1;
+}
+
+void handle_events(machine_t *machine, uint8_t *running)
 {
 	SDL_Event event;
 
 	if (SDL_PollEvent(&event)) {
 		if (event.type == SDL_QUIT) {
 			*running = 0;
+		} else if (event.type == SDL_WINDOWEVENT) {
+			// The window content might be lost after resizing/exposing
+			invalidateScreen();
 		}
 	}
 
-	handle_input(cpu);
+	handle_input(machine);
 }
@@ -0,0 +1,86 @@
+#include <stdint.h>
+
+#include "bus.h"
+#include "cpu.h"
+#include "dynarec.h"
+#include "idle_loop.h"
+#include "machine.h"
+#include "profile.h"
+#include "scheduler.h"
+#include "shift_register.h"
+#include "trace.h"
+
+void initMachine(machine_t *machine)
+{
+	initBus(&machine->bus, &machine->memory);
+	initCPU(&machine->cpu);
+	initShiftRegister(&machine->shiftRegister);
+
+	machine->cpu.machine = machine;
+
+	for (int i = 0; i < 8; i++) {
+		machine->io_port[i] = 0;
+	}
+
+	machine->io_port[0] = 0xE;
+	machine->io_port[1] |= (1 << 3);
+
+	initIdleSkip(&machine->idleSkip);
+	initScheduler(&machine->scheduler);
+	scheduleEvent(&machine->scheduler, EVENT_MID_SCREEN, CYCLES_PER_FRAME / 2);
+	scheduleEvent(&machine->scheduler, EVENT_VBLANK, CYCLES_PER_FRAME);
+
+#ifdef CPU_DYNAREC
+	machine->dynarec = createDynarec();
+#endif
+#ifdef CPU_PROFILE
+	machine->profile = createProfile();
+#endif
+#ifdef CPU_TRACE
+	machine->trace = createTrace();
+#endif
+}
+
+uint8_t runUntilEvent(machine_t *machine)
+{
+	scheduler_t *scheduler = &machine->scheduler;
+	uint64_t cycles = cyclesUntilEvent(scheduler);
+
+	// The cycles it ran over the event count towards the next one
+	if (cycles) {
+		scheduler->now += step_cycles(&machine->cpu, cycles);
+	}
+
+	event_t event = popEvent(scheduler);
+
+	switch (event.type) {
+	case EVENT_MID_SCREEN:
+		setInterruptRoutine(&machine->cpu, 0xCF); // RST 1
+		break;
+	case EVENT_VBLANK:
+		setInterruptRoutine(&machine->cpu, 0xD7); // RST 2
+		break;
+	}
+
+	// Both happen once per frame
+	scheduleEvent(scheduler, event.type, event.time + CYCLES_PER_FRAME);
+
+	return event.type;
+}
+
+void freeMachine(machine_t *machine)
+{
+#ifdef CPU_DYNAREC
+	destroyDynarec(machine->dynarec);
+	machine->dynarec = NULL;
+#endif
+#ifdef CPU_PROFILE
+	destroyProfile(machine->profile);
+	machine->profile = NULL;
+#endif
+#ifdef CPU_TRACE
+	destroyTrace(machine->trace);
+	machine->trace = NULL;
+#endif
+	(void)machine;
+}
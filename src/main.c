@@ -1,67 +1,255 @@
 #include <SDL2/SDL_keyboard.h>
 #include <SDL2/SDL_scancode.h>
 #include <SDL2/SDL_events.h>
-#include <SDL2/SDL_timer.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "batch.h"
 #include "bus.h"
 #include "cpu.h"
+#include "frame_hashes.h"
+#include "frame_pacer.h"
+#include "headless.h"
+#include "machine.h"
 #include "renderer.h"
+#include "rewind.h"
+#include "movie.h"
+#include "profile.h"
+#include "runahead.h"
+#include "scheduler.h"
 #include "input_handler.h"
 
-void emulate_frame(cpu_t *cpu, memory_t *memory)
+// Emulate one frame, the screen is drawn after each half if draw is set
+static void run_frame(machine_t *machine, uint8_t draw)
 {
-	// CPU -> 2 000 000 HZ
-	// Screen -> 60 HZ
-	// -> 200000/60 = 33333 -> ~33K cycles per Frame
-	uint32_t cycles = 0;
-	const uint32_t maxcycles = 2000000 / 60; // ~33K Max Cycles per frame
-	uint64_t start = SDL_GetPerformanceCounter();
-
-	// maxcycles / 2 -> every half an interrupt occurs
-	while (cycles <= maxcycles / 2) {
-		cycles += step(cpu);
-	}
+	uint8_t event;
+
+	// An interrupt in the middle of the screen and one at the end of it
+	do {
+		event = runUntilEvent(machine);
 
-	setInterruptRoutine(cpu, 0xCF);
-	drawScreen(memory);
+		if (draw) {
+			drawScreen(&machine->bus);
+		}
+	} while (event != EVENT_VBLANK);
+}
+
+void emulate_frame(machine_t *machine, rewind_t *history,
+				   runahead_t *runahead, frame_pacer_t *pacer)
+{
+	// With run-ahead the frame ahead is shown instead
+	run_frame(machine, runahead->frames == 0);
+	recordFrame(history, machine);
+	runAhead(runahead, machine, run_frame);
 
-	while (cycles <= maxcycles) {
-		cycles += step(cpu);
+	waitForFrame(pacer);
+}
+
+// Go back the given number of frames in one (real time) frame
+static void rewind_frames(machine_t *machine, rewind_t *history,
+						  uint8_t frames, frame_pacer_t *pacer)
+{
+	for (uint8_t i = 0; i < frames; i++) {
+		if (!rewindFrame(history, machine)) {
+			break;
+		}
 	}
 
-	setInterruptRoutine(cpu, 0xD7);
-	drawScreen(memory);
+	drawScreen(&machine->bus);
+	waitForFrame(pacer);
+}
 
-	uint64_t end = SDL_GetPerformanceCounter();
-	float elapsedMS =
-		(end - start) / (float)SDL_GetPerformanceFrequency() * 1000.0f;
-	SDL_Delay(floor(16.666f - elapsedMS));
+static void printUsage(char *name)
+{
+	printf("Usage: %s [options] <path_to_rom>\n", name);
+	printf("Options:\n");
+	printf("  --headless    Run without SDL as fast as possible and print "
+		   "the throughput\n");
+	printf("  --frames N    Number of frames to run in headless mode "
+		   "(default: 3600)\n");
+	printf("  --cycles N    Number of cycles to run in headless mode "
+		   "(overrides --frames)\n");
+	printf("  --rewind      Record the rewind history in headless mode and "
+		   "print its cost\n");
+	printf("  --run-ahead N Show the frame N frames ahead to hide input lag "
+		   "(default: 0)\n");
+	printf("  --record F    Record the inputs of the session into the movie "
+		   "F\n");
+	printf("  --replay F    Replay the movie F headless as fast as possible "
+		   "(implies --headless)\n");
+	printf("  --hashes F    Write the RAM/VRAM hash of every headless frame "
+		   "to F\n");
+	printf("  --verify F    Compare every headless frame against the hashes "
+		   "in F\n");
+	printf("  --batch N     Run N headless instances on all cores and print "
+		   "the scaling\n");
+	printf("  --threads N   Largest number of worker threads for --batch "
+		   "(default: all CPUs)\n");
+	printf("  --no-idle-skip  Run every iteration of the idle loops (see "
+		   "idle_loop.h)\n");
 }
 
 int main(int argc, char *argv[])
 {
-	if (argc != 2) {
-		printf("Usage: %s <path_to_rom>\n", argv[0]);
+	char *romPath = NULL;
+	uint8_t headless = 0;
+	headless_config_t config = { .frames = 3600, .cycles = 0, .rewind = 0 };
+	batch_config_t batch = { .instances = 0, .threads = 0, .idleSkip = 1 };
+	char *recordPath = NULL;
+	char *replayPath = NULL;
+	char *hashPath = NULL;
+	uint8_t verifyHashes = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0) {
+			headless = 1;
+		} else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			config.frames = strtoull(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+			config.cycles = strtoull(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--rewind") == 0) {
+			config.rewind = 1;
+		} else if (strcmp(argv[i], "--run-ahead") == 0 && i + 1 < argc) {
+			config.runAhead = strtoul(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			recordPath = argv[++i];
+		} else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			replayPath = argv[++i];
+			headless = 1;
+		} else if (strcmp(argv[i], "--hashes") == 0 && i + 1 < argc) {
+			hashPath = argv[++i];
+			verifyHashes = 0;
+			headless = 1;
+		} else if (strcmp(argv[i], "--verify") == 0 && i + 1 < argc) {
+			hashPath = argv[++i];
+			verifyHashes = 1;
+			headless = 1;
+		} else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+			batch.instances = strtoul(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			batch.threads = strtoul(argv[++i], NULL, 0);
+		} else if (strcmp(argv[i], "--no-idle-skip") == 0) {
+			batch.idleSkip = 0;
+		} else if (argv[i][0] != '-' && romPath == NULL) {
+			romPath = argv[i];
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (romPath == NULL) {
+		printUsage(argv[0]);
 		return 1;
 	}
 
-	memory_t memory;
-	cpu_t cpu;
+	if (batch.instances) {
+		batch.romPath = romPath;
+		batch.frames = config.frames;
+		return runBatch(&batch) ? 0 : 1;
+	}
+
+	machine_t machine;
 	uint8_t running = 1;
 
+	initMachine(&machine);
+	loadROM(&machine.bus, romPath);
+	machine.idleSkip.enabled = batch.idleSkip;
+
+	movie_t movie;
+
+	if (headless) {
+		frame_hashes_t hashes;
+		uint8_t success;
+
+		if (replayPath) {
+			loadMovie(&movie, &machine, replayPath);
+			config.movie = &movie;
+		}
+
+		if (hashPath && verifyHashes) {
+			loadFrameHashes(&hashes, &machine, hashPath);
+			config.hashes = &hashes;
+		} else if (hashPath) {
+			initFrameHashes(&hashes);
+			config.hashes = &hashes;
+		}
+
+		success = runHeadless(&machine, &config);
+
+		if (hashPath) {
+			if (!verifyHashes) {
+				success = saveFrameHashes(&hashes, &machine, hashPath);
+			}
+
+			freeFrameHashes(&hashes);
+		}
+
+		if (replayPath) {
+			freeMovie(&movie);
+		}
+
+#ifdef CPU_PROFILE
+		writeProfile(machine.profile);
+#endif
+		freeMachine(&machine);
+		return success ? 0 : 1;
+	}
+
+	if (recordPath) {
+		startRecording(&movie, &machine, recordPath);
+	}
+
+	rewind_t history;
+	runahead_t runahead;
+	initRewind(&history, REWIND_FRAMES, REWIND_BUFFER_SIZE);
+	initRunAhead(&runahead, config.runAhead);
 	initSDL();
-	initBus(&memory);
-	loadROM(argv[1]);
-	initCPU(&cpu);
+
+	frame_pacer_t pacer;
+	initFramePacer(&pacer);
 
 	while (running) {
-		handle_events(&cpu, &running);
-		emulate_frame(&cpu, &memory);
+		handle_events(&machine, &running);
+
+		// Going back would make the recorded inputs useless
+		uint8_t rewindSpeed = recordPath ? 0 : getRewindSpeed();
+
+		if (rewindSpeed) {
+			rewind_frames(&machine, &history, rewindSpeed, &pacer);
+		} else {
+			if (recordPath) {
+				recordInput(&movie, &machine);
+			}
+
+			emulate_frame(&machine, &history, &runahead, &pacer);
+		}
 	}
 
 	killSDL();
 
+	if (recordPath) {
+		stopRecording(&movie);
+		printf("Recorded %u frames in %u runs\n", movie.header.frames,
+			   movie.header.runs);
+	}
+
+	rewind_stats_t stats = getRewindStats(&history);
+	printf("Rewind history: %u frames (%.1f s) in %zu bytes, %zu KB "
+		   "allocated\n",
+		   stats.frames, stats.frames / 60.0, stats.bytesUsed,
+		   stats.memory / 1024);
+
+	printRunAheadStats(&runahead);
+	printFramePacerStats(&pacer);
+	freeFramePacer(&pacer);
+	freeRewind(&history);
+#ifdef CPU_PROFILE
+	writeProfile(machine.profile);
+#endif
+	freeMachine(&machine);
+
 	return 0;
 }
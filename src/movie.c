@@ -0,0 +1,168 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "machine.h"
+#include "movie.h"
+#include "savestate.h"
+
+static void writeOrExit(movie_t *movie, const void *data, size_t size)
+{
+	if (1 != fwrite(data, size, 1, movie->file)) {
+		fprintf(stderr, "Failed to write the movie!\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void startRecording(movie_t *movie, const machine_t *machine,
+					const char *path)
+{
+	movie->file = fopen(path, "wb");
+
+	if (NULL == movie->file) {
+		fprintf(stderr, "Could not create movie: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	movie->header.magic = MOVIE_MAGIC;
+	movie->header.version = MOVIE_VERSION;
+	movie->header.reserved = 0;
+	movie->header.frames = 0;
+	movie->header.runs = 0;
+	snapshotState(machine, &movie->header.initial);
+	movie->runs = NULL;
+	movie->current = (movie_run_t){ .length = 0 };
+
+	// Rewritten with the real counts by stopRecording()
+	writeOrExit(movie, &movie->header, sizeof(movie->header));
+}
+
+static void finishRun(movie_t *movie)
+{
+	writeOrExit(movie, &movie->current, sizeof(movie->current));
+	movie->header.runs++;
+}
+
+void recordInput(movie_t *movie, const machine_t *machine)
+{
+	movie_run_t *run = &movie->current;
+	uint8_t port1 = machine->io_port[1];
+	uint8_t port2 = machine->io_port[2];
+	uint8_t changed = run->port1 != port1 || run->port2 != port2;
+
+	if (run->length > 0 && (changed || run->length == UINT16_MAX)) {
+		finishRun(movie);
+		run->length = 0;
+	}
+
+	run->port1 = port1;
+	run->port2 = port2;
+	run->length++;
+	movie->header.frames++;
+}
+
+void stopRecording(movie_t *movie)
+{
+	if (movie->current.length > 0) {
+		finishRun(movie);
+	}
+
+	if (0 != fseek(movie->file, 0, SEEK_SET)) {
+		fprintf(stderr, "Failed to write the movie!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	writeOrExit(movie, &movie->header, sizeof(movie->header));
+	fclose(movie->file);
+	movie->file = NULL;
+}
+
+void loadMovie(movie_t *movie, machine_t *machine, const char *path)
+{
+	FILE *file = fopen(path, "rb");
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not open movie: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	movie_header_t *header = &movie->header;
+
+	if (1 != fread(header, sizeof(*header), 1, file) ||
+		header->magic != MOVIE_MAGIC) {
+		fprintf(stderr, "Not a movie: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	if (header->version != MOVIE_VERSION) {
+		fprintf(stderr, "Unsupported movie version %u: %s\n", header->version,
+				path);
+		exit(EXIT_FAILURE);
+	}
+
+	// One more so an empty movie does not allocate 0 bytes
+	movie->runs = malloc(((size_t)header->runs + 1) * sizeof(movie_run_t));
+
+	if (NULL == movie->runs) {
+		fprintf(stderr, "Could not allocate the movie!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (header->runs != fread(movie->runs, sizeof(movie_run_t), header->runs,
+							  file)) {
+		fprintf(stderr, "Movie is truncated: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	fclose(file);
+
+	uint64_t frames = 0;
+
+	for (uint32_t i = 0; i < header->runs; i++) {
+		frames += movie->runs[i].length;
+	}
+
+	if (frames != header->frames) {
+		fprintf(stderr, "Movie is corrupted: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	switch (restoreState(machine, &header->initial)) {
+	case SAVESTATE_OK:
+		break;
+	case SAVESTATE_WRONG_ROM:
+		fprintf(stderr, "Movie was recorded with a different ROM: %s\n",
+				path);
+		exit(EXIT_FAILURE);
+	default:
+		fprintf(stderr, "Movie has an invalid initial state: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	movie->file = NULL;
+	movie->current.length = 0;
+	movie->nextRun = 0;
+}
+
+uint8_t playInput(movie_t *movie, machine_t *machine)
+{
+	while (movie->current.length == 0) {
+		if (movie->nextRun == movie->header.runs) {
+			return 0;
+		}
+
+		movie->current = movie->runs[movie->nextRun++];
+	}
+
+	movie->current.length--;
+	machine->io_port[1] = movie->current.port1;
+	machine->io_port[2] = movie->current.port2;
+
+	return 1;
+}
+
+void freeMovie(movie_t *movie)
+{
+	free(movie->runs);
+	movie->runs = NULL;
+}
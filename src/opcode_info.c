@@ -0,0 +1,12 @@
+#include <stdint.h>
+
+#include "opcode_info.h"
+#include "opcodes.h"
+
+const opcode_info_t opcodeInfo[256] = {
+#define X(code, op, x, y, length, cycles)                                 \
+	[code] = { INSTR_##op, OPERAND_##x, OPERAND_##y, length, cycles, #op, \
+			   #x, #y },
+	OPCODE_TABLE(X)
+#undef X
+};
@@ -0,0 +1,373 @@
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+#ifdef CPU_PROFILE
+
+#include "opcode_info.h"
+#include "rom_cache.h"
+
+#define REPORT_PATH "profile.txt"
+#define COVERAGE_PATH "coverage.pbm"
+#define COVERAGE_WIDTH 128
+#define HOT_ADDRESSES 50
+#define HOT_BRANCHES 30
+
+typedef struct counter {
+	uint64_t executions;
+	uint64_t cycles;
+} counter_t;
+
+typedef struct address_counter {
+	counter_t counter;
+	uint64_t taken; // Conditional instructions only
+	uint8_t opcode; // The counts are for this one
+} address_counter_t;
+
+// Only the addresses are counted while running, the opcode and total counts
+// are added up from them for the report. Updating the same few counters on
+// every instruction would make the profiled build twice as slow.
+//
+// Code in RAM can put another opcode at an address (the CP/M exercisers
+// rewrite the instruction under test), then the counts of the old one are
+// moved to spilled and the address starts over.
+struct profile {
+	address_counter_t addresses[0x10000];
+	counter_t interrupts[256]; // Opcodes injected by an interrupt
+	counter_t spilled[256]; // Opcodes that were replaced at their address
+	uint8_t conditional[256]; // JMPC, CALLC and RETC
+};
+
+// One flag for the process, the handler can't know the machines
+static volatile sig_atomic_t dumpRequested = 0;
+
+static void requestDump(int number)
+{
+	(void)number;
+	dumpRequested = 1;
+}
+
+profile_t *createProfile(void)
+{
+	profile_t *profile = calloc(1, sizeof(profile_t));
+
+	if (NULL == profile) {
+		fprintf(stderr, "Could not allocate the profile!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int opcode = 0; opcode < 256; opcode++) {
+		profile->conditional[opcode] =
+			isConditional(opcodeInfo[opcode].instruction);
+	}
+
+	signal(SIGUSR1, requestDump);
+
+	return profile;
+}
+
+void destroyProfile(profile_t *profile)
+{
+	free(profile);
+}
+
+void profileStep(profile_t *profile, uint16_t pc, uint8_t opcode,
+				 uint8_t cycles, uint16_t nextPC, uint8_t interrupt)
+{
+	// The instruction at pc was not executed
+	if (interrupt) {
+		profile->interrupts[opcode].executions++;
+		profile->interrupts[opcode].cycles += cycles;
+		return;
+	}
+
+	address_counter_t *address = &profile->addresses[pc];
+
+	if (address->opcode != opcode) {
+		counter_t *spilled = &profile->spilled[address->opcode];
+
+		spilled->executions += address->counter.executions;
+		spilled->cycles += address->counter.cycles;
+		*address = (address_counter_t){ .opcode = opcode };
+	}
+
+	address->counter.executions++;
+	address->counter.cycles += cycles;
+
+	if (profile->conditional[opcode]) {
+		uint16_t next = pc + opcodeInfo[opcode].length;
+		address->taken += nextPC != next;
+	}
+}
+
+typedef struct entry {
+	uint32_t index;
+	uint64_t key;
+} entry_t;
+
+static int compareEntries(const void *a, const void *b)
+{
+	const entry_t *first = a;
+	const entry_t *second = b;
+
+	// Largest first, then by index
+	if (first->key != second->key) {
+		return first->key < second->key ? 1 : -1;
+	}
+
+	return first->index < second->index ? -1 : 1;
+}
+
+static void printInstruction(FILE *out, uint8_t opcode)
+{
+	const opcode_info_t *info = &opcodeInfo[opcode];
+	char text[16];
+
+	if (info->x == OPERAND__) {
+		snprintf(text, sizeof(text), "%s", info->name);
+	} else if (info->y == OPERAND__) {
+		snprintf(text, sizeof(text), "%s %s", info->name, info->xName);
+	} else {
+		snprintf(text, sizeof(text), "%s %s,%s", info->name, info->xName,
+				 info->yName);
+	}
+
+	fprintf(out, "%-10s", text);
+}
+
+static double percent(uint64_t part, uint64_t whole)
+{
+	return whole ? 100.0 * part / whole : 0;
+}
+
+// Add up the counts of every opcode and the totals
+static void sumOpcodes(const profile_t *profile, counter_t *opcodes,
+					   counter_t *total)
+{
+	for (int opcode = 0; opcode < 256; opcode++) {
+		opcodes[opcode].executions = profile->interrupts[opcode].executions +
+									 profile->spilled[opcode].executions;
+		opcodes[opcode].cycles = profile->interrupts[opcode].cycles +
+								 profile->spilled[opcode].cycles;
+	}
+
+	for (uint32_t pc = 0; pc < 0x10000; pc++) {
+		const address_counter_t *address = &profile->addresses[pc];
+
+		opcodes[address->opcode].executions += address->counter.executions;
+		opcodes[address->opcode].cycles += address->counter.cycles;
+	}
+
+	*total = (counter_t){ 0, 0 };
+
+	for (int opcode = 0; opcode < 256; opcode++) {
+		total->executions += opcodes[opcode].executions;
+		total->cycles += opcodes[opcode].cycles;
+	}
+}
+
+static void writeOpcodes(FILE *out, const counter_t *opcodes,
+						 const counter_t *total)
+{
+	entry_t entries[256];
+	int count = 0;
+
+	for (int opcode = 0; opcode < 256; opcode++) {
+		if (opcodes[opcode].executions) {
+			entries[count].index = opcode;
+			entries[count++].key = opcodes[opcode].cycles;
+		}
+	}
+
+	qsort(entries, count, sizeof(entry_t), compareEntries);
+
+	fprintf(out, "\nOpcodes by cycles:\n");
+	fprintf(out, "  Op  Instruction  Executions        Cycles  %%Cycles\n");
+
+	for (int i = 0; i < count; i++) {
+		const counter_t *counter = &opcodes[entries[i].index];
+
+		fprintf(out, "  %02X  ", entries[i].index);
+		printInstruction(out, entries[i].index);
+		fprintf(out, "   %12llu  %12llu  %6.2f%%\n",
+				(unsigned long long)counter->executions,
+				(unsigned long long)counter->cycles,
+				percent(counter->cycles, total->cycles));
+	}
+}
+
+// Sort the executed addresses by cycles, or only the conditional ones by
+// executions. Returns how many there are.
+static uint32_t sortAddresses(const profile_t *profile, entry_t *entries,
+							  uint8_t branchesOnly)
+{
+	uint32_t count = 0;
+
+	for (uint32_t pc = 0; pc < 0x10000; pc++) {
+		const address_counter_t *address = &profile->addresses[pc];
+
+		if (address->counter.executions == 0 ||
+			(branchesOnly && !profile->conditional[address->opcode])) {
+			continue;
+		}
+
+		entries[count].index = pc;
+		entries[count++].key = branchesOnly ? address->counter.executions :
+											  address->counter.cycles;
+	}
+
+	qsort(entries, count, sizeof(entry_t), compareEntries);
+
+	return count;
+}
+
+static void writeAddresses(FILE *out, const profile_t *profile,
+						   const counter_t *total, entry_t *entries)
+{
+	uint32_t count = sortAddresses(profile, entries, 0);
+
+	fprintf(out, "\nHottest addresses by cycles (%u executed):\n", count);
+	fprintf(out, "  PC    Instruction  Executions        Cycles  %%Cycles\n");
+
+	for (uint32_t i = 0; i < count && i < HOT_ADDRESSES; i++) {
+		const address_counter_t *address =
+			&profile->addresses[entries[i].index];
+
+		fprintf(out, "  %04X  ", entries[i].index);
+		printInstruction(out, address->opcode);
+		fprintf(out, "   %12llu  %12llu  %6.2f%%\n",
+				(unsigned long long)address->counter.executions,
+				(unsigned long long)address->counter.cycles,
+				percent(address->counter.cycles, total->cycles));
+	}
+}
+
+static void writeBranches(FILE *out, const profile_t *profile,
+						  entry_t *entries)
+{
+	uint32_t count = sortAddresses(profile, entries, 1);
+
+	fprintf(out, "\nConditional branches by executions (%u executed):\n",
+			count);
+	fprintf(out, "  PC    Instruction  Executions         Taken   %%Taken\n");
+
+	for (uint32_t i = 0; i < count && i < HOT_BRANCHES; i++) {
+		const address_counter_t *address =
+			&profile->addresses[entries[i].index];
+
+		fprintf(out, "  %04X  ", entries[i].index);
+		printInstruction(out, address->opcode);
+		fprintf(out, "   %12llu  %12llu  %6.2f%%\n",
+				(unsigned long long)address->counter.executions,
+				(unsigned long long)address->taken,
+				percent(address->taken, address->counter.executions));
+	}
+}
+
+// Mark every ROM byte that was executed as part of an instruction
+static uint32_t findCoverage(const profile_t *profile, uint8_t *covered)
+{
+	uint32_t count = 0;
+
+	memset(covered, 0, ROM_SIZE);
+
+	for (uint32_t pc = 0; pc < ROM_SIZE; pc++) {
+		const address_counter_t *address = &profile->addresses[pc];
+
+		if (address->counter.executions == 0) {
+			continue;
+		}
+
+		for (uint32_t i = 0; i < opcodeInfo[address->opcode].length &&
+							 pc + i < ROM_SIZE;
+			 i++) {
+			covered[pc + i] = 1;
+		}
+	}
+
+	for (uint32_t i = 0; i < ROM_SIZE; i++) {
+		count += covered[i];
+	}
+
+	return count;
+}
+
+static void writeCoverage(const uint8_t *covered)
+{
+	FILE *file = fopen(COVERAGE_PATH, "w");
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not create %s\n", COVERAGE_PATH);
+		return;
+	}
+
+	fprintf(file, "P1\n# ROM coverage, one pixel per byte\n%d %d\n",
+			COVERAGE_WIDTH, ROM_SIZE / COVERAGE_WIDTH);
+
+	for (uint32_t i = 0; i < ROM_SIZE; i++) {
+		fputc(covered[i] ? '1' : '0', file);
+		fputc((i + 1) % COVERAGE_WIDTH ? ' ' : '\n', file);
+	}
+
+	fclose(file);
+}
+
+void writeProfile(const profile_t *profile)
+{
+	FILE *out = fopen(REPORT_PATH, "w");
+
+	if (NULL == out) {
+		fprintf(stderr, "Could not create %s\n", REPORT_PATH);
+		return;
+	}
+
+	counter_t opcodes[256];
+	counter_t total;
+	uint64_t interrupts = 0;
+	uint8_t covered[ROM_SIZE];
+	uint32_t coveredBytes = findCoverage(profile, covered);
+	entry_t *entries = malloc(0x10000 * sizeof(entry_t));
+
+	if (NULL == entries) {
+		fprintf(stderr, "Could not allocate the profile report!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	sumOpcodes(profile, opcodes, &total);
+
+	for (int opcode = 0; opcode < 256; opcode++) {
+		interrupts += profile->interrupts[opcode].executions;
+	}
+
+	fprintf(out, "Instructions:  %llu\n", (unsigned long long)total.executions);
+	fprintf(out, "Cycles:        %llu\n", (unsigned long long)total.cycles);
+	fprintf(out, "Interrupts:    %llu\n", (unsigned long long)interrupts);
+	fprintf(out, "ROM coverage:  %u of %d bytes (%.1f%%), see %s\n",
+			coveredBytes, ROM_SIZE, percent(coveredBytes, ROM_SIZE),
+			COVERAGE_PATH);
+
+	writeOpcodes(out, opcodes, &total);
+	writeAddresses(out, profile, &total, entries);
+	writeBranches(out, profile, entries);
+
+	free(entries);
+	fclose(out);
+	writeCoverage(covered);
+
+	fprintf(stderr, "Profile written to %s and %s\n", REPORT_PATH,
+			COVERAGE_PATH);
+}
+
+void pollProfileSignal(const profile_t *profile)
+{
+	if (dumpRequested) {
+		dumpRequested = 0;
+		writeProfile(profile);
+	}
+}
+
+#endif
@@ -4,15 +4,23 @@
 #include <SDL2/SDL.h>
 
 #include "bus.h"
+#include "vram_convert.h"
 
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
+static SDL_Texture *texture = NULL;
 
 #define SCALE 3
 
 // 256x224 Pixels
-#define WIDTH 256
-#define HEIGHT 224
+#define WIDTH SCREEN_WIDTH
+#define HEIGHT SCREEN_HEIGHT
+
+// The already rotated screen (HEIGHT pixels per row, WIDTH rows)
+static uint32_t pixels[WIDTH * HEIGHT];
+
+// Redraw the whole screen on the next drawScreen() call
+static uint8_t forceRedraw = 1;
 
 void initSDL(void)
 {
@@ -41,10 +49,30 @@ void initSDL(void)
 		SDL_Quit();
 		exit(EXIT_FAILURE);
 	}
+
+	// Keep the pixels sharp when scaling the texture to the window size
+	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+								SDL_TEXTUREACCESS_STREAMING, HEIGHT, WIDTH);
+
+	if (NULL == texture) {
+		fprintf(stderr, "Could not create SDL Texture!\n");
+		SDL_DestroyRenderer(renderer);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		exit(EXIT_FAILURE);
+	}
+
+	initVRAMConverter();
 }
 
 void killSDL(void)
 {
+	if (texture) {
+		SDL_DestroyTexture(texture);
+	}
+
 	if (renderer) {
 		SDL_DestroyRenderer(renderer);
 	}
@@ -56,75 +84,52 @@ void killSDL(void)
 	SDL_Quit();
 }
 
-void drawScreen(memory_t *memory)
+void invalidateScreen(void)
 {
-	int32_t width = 0;
-	int32_t height = 0;
-	SDL_GetWindowSize(window, &width, &height);
+	forceRedraw = 1;
+}
 
-	float scale_x = (float)width / HEIGHT;
-	float scale_y = (float)height / WIDTH;
+void drawScreen(bus_t *bus)
+{
+	uint32_t stripes = takeDirtyStripes(bus);
 
-	// First clear the whole screen
-	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-	SDL_RenderClear(renderer);
-	SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
-
-	for (int y = 0; y < HEIGHT; y++) {
-		for (int x = 0; x < WIDTH; x++) {
-			// Example:
-			//	2D Array 4x3 (imagine this is the screen)
-			// [ ][ ][ ][ ]
-			// [ ][ ][x][ ] -> (2,1)
-			// [ ][ ][ ][ ]
-			// Here each row has 4 elements representing 1 pixel
-			// offset = coord_y * elements_per_row + coord_x / number_of_pixels
-			// (how many pixels per element, 1 pixel in this case)
-			// offset = 1 * 4 + 2 * 1
-			// = 6
-			// 	1D Array
-			// [][][][][][][x][][][][][] -> arr[6]
-
-			// Each byte represents 8 pixels, there are 256 pixels
-			// (horizontal resolution) per row:
-			// 256 / 8 = 32 bytes
-			// we also have
-			// Now since our array is in bytes (meaning 1 element represents 8 pixels),
-			// we need to map each byte to 8 pixels
-			// offset = y * 32 + x / 8 (if we would multiply instead,
-			// it would mean we map each pixel to 8 bytes!)
-
-			uint16_t address = y * 32 + x / 8;
-			uint8_t bit = x % 8; // the current pixel we are looking for
-			uint8_t data = memory->vram[address];
-
-			if ((data & (1 << bit))) {
-				// The screen in the Space Invaders cabinet is rotated 90 degree counter clockwise
-				// this means we also flip the coordinate system by 90 degree
-				// this causes the normal x,y coordinate system to become x',y' where x' = y and y' = x
-				// but since the top left is 0,0, and the bottom left is max_x we need to substract y' from max_x
-
-				// Using rectangles as pixels instead of just small dots looks
-				// cleaner but the dot way looks more retro :D
-
-				// SDL_RenderDrawPoint(renderer, y * SCALE,
-				// 					(WIDTH - 1 - x) * SCALE);
-
-				SDL_Rect rect;
-
-				rect.x =
-					(int)(y *
-						  scale_x); // Scale the y-coordinate to fit the new width
-				rect.y =
-					(int)((WIDTH - 1 - x) *
-						  scale_y); // Scale the x-coordinate (inverted) to fit the new height
-				rect.w = (int)(scale_x); // Scale the rectangle width
-				rect.h = (int)(scale_y);
-
-				SDL_RenderFillRect(renderer, &rect);
-			}
+	if (forceRedraw) {
+		stripes = 0xFFFFFFFF;
+		forceRedraw = 0;
+	}
+
+	// Nothing changed since the last frame, keep showing it
+	if (stripes == 0) {
+		return;
+	}
+
+	convertVRAMStripes(bus->memory->vram, pixels, stripes);
+
+	// Upload every run of consecutive dirty stripes at once. Stripe n ends
+	// up in the rows WIDTH - 8 * (n + 1) ... WIDTH - 1 - 8 * n
+	for (int first = 0; first < VRAM_STRIPES; first++) {
+		if (!(stripes & (1u << first))) {
+			continue;
 		}
+
+		int last = first;
+		while (last + 1 < VRAM_STRIPES && (stripes & (1u << (last + 1)))) {
+			last++;
+		}
+
+		SDL_Rect rect;
+		rect.x = 0;
+		rect.y = WIDTH - 8 * (last + 1);
+		rect.w = HEIGHT;
+		rect.h = 8 * (last - first + 1);
+
+		SDL_UpdateTexture(texture, &rect, &pixels[rect.y * HEIGHT],
+						  HEIGHT * sizeof(uint32_t));
+
+		first = last;
 	}
 
+	SDL_RenderClear(renderer);
+	SDL_RenderCopy(renderer, texture, NULL, NULL);
 	SDL_RenderPresent(renderer);
 }
@@ -0,0 +1,245 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "machine.h"
+#include "rewind.h"
+#include "savestate.h"
+
+static uint64_t load64(const uint8_t *bytes)
+{
+	uint64_t value;
+	memcpy(&value, bytes, sizeof(value));
+
+	return value;
+}
+
+static void store16(uint8_t *bytes, uint16_t value)
+{
+	memcpy(bytes, &value, sizeof(value));
+}
+
+static uint16_t load16(const uint8_t *bytes)
+{
+	uint16_t value;
+	memcpy(&value, bytes, sizeof(value));
+
+	return value;
+}
+
+// Encode a XOR b into out (see rewind.h), returns the encoded size
+static size_t encodeDelta(const uint8_t *a, const uint8_t *b, size_t size,
+						  uint8_t *out)
+{
+	size_t written = 0;
+	size_t runEnd = 0; // End of the last run
+	size_t pos = 0;
+
+	for (;;) {
+		// Most of the state doesn't change, skip it in large steps first
+		while (pos + 64 <= size && memcmp(a + pos, b + pos, 64) == 0) {
+			pos += 64;
+		}
+
+		while (pos + 8 <= size && load64(a + pos) == load64(b + pos)) {
+			pos += 8;
+		}
+
+		while (pos < size && a[pos] == b[pos]) {
+			pos++;
+		}
+
+		if (pos == size) {
+			return written;
+		}
+
+		// The run ends once 4 bytes in a row are the same
+		size_t start = pos;
+		size_t end = pos;
+
+		while (pos < size && pos - end < 4) {
+			if (a[pos] != b[pos]) {
+				end = pos + 1;
+			}
+
+			pos++;
+		}
+
+		store16(&out[written], start - runEnd);
+		store16(&out[written + 2], end - start);
+		written += 4;
+
+		for (size_t i = start; i < end; i++) {
+			out[written++] = a[i] ^ b[i];
+		}
+
+		runEnd = end;
+		pos = end;
+	}
+}
+
+// XOR an encoded delta into state
+static void applyDelta(uint8_t *state, const uint8_t *delta, size_t size)
+{
+	size_t read = 0;
+	uint8_t *pos = state;
+
+	while (read < size) {
+		pos += load16(&delta[read]);
+		uint16_t length = load16(&delta[read + 2]);
+		read += 4;
+
+		for (uint16_t i = 0; i < length; i++) {
+			*pos++ ^= delta[read++];
+		}
+	}
+}
+
+void initRewind(rewind_t *history, uint32_t maxFrames, size_t bufferSize)
+{
+	if (bufferSize < REWIND_MAX_DELTA || maxFrames == 0) {
+		fprintf(stderr, "Rewind buffer is too small!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	history->buffer = malloc(bufferSize);
+	history->frames = malloc(maxFrames * sizeof(rewind_frame_t));
+
+	if (NULL == history->buffer || NULL == history->frames) {
+		fprintf(stderr, "Could not allocate the rewind buffer!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	history->bufferSize = bufferSize;
+	history->maxFrames = maxFrames;
+	clearRewind(history);
+}
+
+void freeRewind(rewind_t *history)
+{
+	free(history->buffer);
+	free(history->frames);
+	history->buffer = NULL;
+	history->frames = NULL;
+}
+
+void clearRewind(rewind_t *history)
+{
+	history->first = 0;
+	history->count = 0;
+	history->bytesUsed = 0;
+	history->hasState = 0;
+}
+
+static void dropOldest(rewind_t *history)
+{
+	history->bytesUsed -= history->frames[history->first].size;
+	history->first = (history->first + 1) % history->maxFrames;
+	history->count--;
+}
+
+static rewind_frame_t *newestFrame(rewind_t *history)
+{
+	uint32_t index = history->first + history->count - 1;
+
+	return &history->frames[index % history->maxFrames];
+}
+
+// Store the encoded delta after the newest one, dropping the oldest frames
+// until it fits
+static void storeDelta(rewind_t *history, size_t size)
+{
+	uint32_t offset = 0;
+
+	if (history->count == history->maxFrames) {
+		dropOldest(history);
+	}
+
+	if (history->count > 0) {
+		rewind_frame_t *newest = newestFrame(history);
+		uint32_t end = newest->offset + newest->size;
+
+		if (end + size <= history->bufferSize) {
+			offset = end;
+		} else {
+			// Wrap around, everything behind the newest delta is older
+			// than what is at the start of the buffer
+			while (history->count > 0 &&
+				   history->frames[history->first].offset >= end) {
+				dropOldest(history);
+			}
+		}
+	}
+
+	while (history->count > 0) {
+		rewind_frame_t *oldest = &history->frames[history->first];
+
+		if (oldest->offset >= offset + size ||
+			oldest->offset + oldest->size <= offset) {
+			break;
+		}
+
+		dropOldest(history);
+	}
+
+	memcpy(&history->buffer[offset], history->encoded, size);
+
+	history->count++;
+	history->bytesUsed += size;
+	newestFrame(history)->offset = offset;
+	newestFrame(history)->size = size;
+}
+
+void recordFrame(rewind_t *history, const machine_t *machine)
+{
+	snapshotState(machine, &history->snapshot);
+
+	if (history->hasState) {
+		size_t size = encodeDelta((const uint8_t *)&history->snapshot,
+								  (const uint8_t *)&history->newest,
+								  sizeof(savestate_t), history->encoded);
+		storeDelta(history, size);
+
+		// Only the changed bytes have to be copied
+		applyDelta((uint8_t *)&history->newest, history->encoded, size);
+	} else {
+		history->newest = history->snapshot;
+	}
+
+	history->hasState = 1;
+}
+
+uint8_t rewindFrame(rewind_t *history, machine_t *machine)
+{
+	if (!history->hasState) {
+		return 0;
+	}
+
+	uint8_t older = history->count > 0;
+
+	if (older) {
+		rewind_frame_t *newest = newestFrame(history);
+
+		applyDelta((uint8_t *)&history->newest,
+				   &history->buffer[newest->offset], newest->size);
+		history->bytesUsed -= newest->size;
+		history->count--;
+	}
+
+	restoreState(machine, &history->newest);
+
+	return older;
+}
+
+rewind_stats_t getRewindStats(const rewind_t *history)
+{
+	rewind_stats_t stats = {
+		.frames = history->count,
+		.bytesUsed = history->bytesUsed,
+		.memory = sizeof(rewind_t) + history->bufferSize +
+				  history->maxFrames * sizeof(rewind_frame_t),
+	};
+
+	return stats;
+}
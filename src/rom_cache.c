@@ -0,0 +1,24 @@
+#include <stdint.h>
+
+#include "rom_cache.h"
+
+void decodeROM(rom_cache_t *cache, const uint8_t *rom)
+{
+	// Every address is decoded, code may jump into the middle of what
+	// looks like another instruction
+	for (int address = 0; address < ROM_CACHE_SIZE; address++) {
+		cache->decoded[address].opcode = rom[address];
+		cache->decoded[address].operand = rom[address + 1] |
+										  rom[address + 2] << 8;
+		cache->decoded[address].idleLoop = 0;
+	}
+
+	cache->idleLoopCount = findIdleLoops(rom, cache->idleLoops);
+
+	for (uint8_t i = 0; i < cache->idleLoopCount; i++) {
+		cache->decoded[cache->idleLoops[i].jump].idleLoop = i + 1;
+	}
+
+	cache->size = ROM_CACHE_SIZE;
+	cache->hash = hashBytes(rom, ROM_SIZE);
+}
@@ -0,0 +1,67 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "host_time.h"
+#include "machine.h"
+#include "runahead.h"
+#include "savestate.h"
+
+void initRunAhead(runahead_t *runahead, uint32_t frames)
+{
+	if (frames > RUNAHEAD_MAX_FRAMES) {
+		fprintf(stderr, "Run-ahead is limited to %d frames!\n",
+				RUNAHEAD_MAX_FRAMES);
+		frames = RUNAHEAD_MAX_FRAMES;
+	}
+
+	runahead->frames = frames;
+	runahead->totalNS = 0;
+	runahead->maxNS = 0;
+	runahead->count = 0;
+}
+
+void runAhead(runahead_t *runahead, machine_t *machine,
+			  frame_function_t frame)
+{
+	if (runahead->frames == 0) {
+		return;
+	}
+
+	uint64_t start = getTimeNS();
+
+	snapshotState(machine, &runahead->state);
+
+	// Only the last frame is drawn
+	for (uint8_t i = 1; i < runahead->frames; i++) {
+		frame(machine, 0);
+	}
+
+	frame(machine, 1);
+	restoreState(machine, &runahead->state);
+
+	uint64_t elapsed = getTimeNS() - start;
+
+	runahead->totalNS += elapsed;
+	runahead->count++;
+
+	if (elapsed > runahead->maxNS) {
+		runahead->maxNS = elapsed;
+	}
+}
+
+void printRunAheadStats(const runahead_t *runahead)
+{
+	if (runahead->count == 0) {
+		return;
+	}
+
+	double average = (double)runahead->totalNS / runahead->count;
+
+	// A 60 Hz frame has 16.67 ms
+	printf("Run-ahead (%u frames): %.1f us/frame added on average (%.2f%% of "
+		   "a 60 Hz frame), %.1f us at most\n",
+		   runahead->frames, average / 1e3, average / 1e9 * 60 * 100,
+		   runahead->maxNS / 1e3);
+}
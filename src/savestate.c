@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bus.h"
+#include "cpu.h"
+#include "flags.h"
+#include "machine.h"
+#include "savestate.h"
+#include "scheduler.h"
+
+void snapshotState(const machine_t *machine, savestate_t *state)
+{
+	const cpu_t *cpu = &machine->cpu;
+
+	state->magic = SAVESTATE_MAGIC;
+	state->version = SAVESTATE_VERSION;
+	state->size = sizeof(savestate_t);
+	state->romHash = machine->bus.romCache.hash;
+	state->instructions = cpu->instructions;
+	state->cycles = machine->scheduler.now;
+
+	for (uint8_t type = 0; type < EVENT_COUNT; type++) {
+		state->events[type] = getEventTime(&machine->scheduler, type);
+	}
+
+	state->BC = cpu->BC.reg;
+	state->DE = cpu->DE.reg;
+	state->HL = cpu->HL.reg;
+	state->SP = cpu->SP;
+	state->PC = cpu->PC;
+	state->A = cpu->AF.highByte;
+	state->F = get_flags(cpu);
+	state->opcode = cpu->opcode;
+	state->interrupt = cpu->interrupt;
+	state->interrupt_enabled = cpu->interrupt_enabled;
+	state->halted = cpu->halted;
+
+	state->shiftValue = machine->shiftRegister.value;
+	state->shiftOffset = machine->shiftRegister.offset;
+	memcpy(state->io_port, machine->io_port, sizeof(state->io_port));
+	memset(state->reserved, 0, sizeof(state->reserved));
+
+	memcpy(state->ram, machine->memory.ram, sizeof(state->ram));
+	memcpy(state->vram, machine->memory.vram, sizeof(state->vram));
+}
+
+enum SAVESTATE_RESULT restoreState(machine_t *machine, const savestate_t *state)
+{
+	if (state->magic != SAVESTATE_MAGIC ||
+		state->size != sizeof(savestate_t)) {
+		return SAVESTATE_INVALID;
+	}
+
+	if (state->version != SAVESTATE_VERSION) {
+		return SAVESTATE_WRONG_VERSION;
+	}
+
+	if (state->romHash != machine->bus.romCache.hash) {
+		return SAVESTATE_WRONG_ROM;
+	}
+
+	cpu_t *cpu = &machine->cpu;
+
+	cpu->instructions = state->instructions;
+	cpu->BC.reg = state->BC;
+	cpu->DE.reg = state->DE;
+	cpu->HL.reg = state->HL;
+	cpu->SP = state->SP;
+	cpu->PC = state->PC;
+	cpu->AF.highByte = state->A;
+	cpu->AF.lowByte = state->F;
+	cpu->lazy.op = LAZY_NONE;
+#ifdef LAZY_FLAGS_VALIDATE
+	cpu->eager_flags = state->F;
+#endif
+	cpu->opcode = state->opcode;
+	cpu->interrupt = state->interrupt;
+	cpu->interrupt_enabled = state->interrupt_enabled;
+	cpu->halted = state->halted;
+
+	machine->shiftRegister.value = state->shiftValue;
+	machine->shiftRegister.offset = state->shiftOffset;
+	memcpy(machine->io_port, state->io_port, sizeof(state->io_port));
+
+	memcpy(machine->memory.ram, state->ram, sizeof(state->ram));
+	memcpy(machine->memory.vram, state->vram, sizeof(state->vram));
+
+	initScheduler(&machine->scheduler);
+	machine->scheduler.now = state->cycles;
+
+	for (uint8_t type = 0; type < EVENT_COUNT; type++) {
+		if (state->events[type] != EVENT_NEVER) {
+			scheduleEvent(&machine->scheduler, type, state->events[type]);
+		}
+	}
+
+	// The whole screen may have changed
+	machine->bus.dirtyStripes = 0xFFFFFFFF;
+
+	return SAVESTATE_OK;
+}
+
+uint8_t saveStateToFile(const machine_t *machine, const char *path)
+{
+	savestate_t state;
+	snapshotState(machine, &state);
+
+	FILE *file = fopen(path, "wb");
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not create save state: %s\n", path);
+		return 0;
+	}
+
+	size_t result = fwrite(&state, sizeof(state), 1, file);
+	fclose(file);
+
+	if (1 != result) {
+		fprintf(stderr, "Failed to write save state: %s\n", path);
+		return 0;
+	}
+
+	return 1;
+}
+
+enum SAVESTATE_RESULT loadStateFromFile(machine_t *machine, const char *path)
+{
+	savestate_t state;
+	FILE *file = fopen(path, "rb");
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not open save state: %s\n", path);
+		return SAVESTATE_INVALID;
+	}
+
+	size_t result = fread(&state, sizeof(state), 1, file);
+	fclose(file);
+
+	if (1 != result) {
+		return SAVESTATE_INVALID;
+	}
+
+	return restoreState(machine, &state);
+}
@@ -0,0 +1,100 @@
+#include <stdint.h>
+
+#include "scheduler.h"
+
+void initScheduler(scheduler_t *scheduler)
+{
+	scheduler->now = 0;
+	scheduler->count = 0;
+}
+
+static void swapEvents(event_t *a, event_t *b)
+{
+	event_t swap = *a;
+	*a = *b;
+	*b = swap;
+}
+
+// Move the event at index up until its parent is not later
+static void siftUp(scheduler_t *scheduler, uint8_t index)
+{
+	event_t *heap = scheduler->heap;
+
+	while (index > 0 && heap[(index - 1) / 2].time > heap[index].time) {
+		swapEvents(&heap[(index - 1) / 2], &heap[index]);
+		index = (index - 1) / 2;
+	}
+}
+
+// Move the event at index down until no child is earlier
+static void siftDown(scheduler_t *scheduler, uint8_t index)
+{
+	event_t *heap = scheduler->heap;
+
+	for (;;) {
+		uint8_t earliest = index;
+		uint8_t left = 2 * index + 1;
+		uint8_t right = 2 * index + 2;
+
+		if (left < scheduler->count &&
+			heap[left].time < heap[earliest].time) {
+			earliest = left;
+		}
+
+		if (right < scheduler->count &&
+			heap[right].time < heap[earliest].time) {
+			earliest = right;
+		}
+
+		if (earliest == index) {
+			return;
+		}
+
+		swapEvents(&heap[earliest], &heap[index]);
+		index = earliest;
+	}
+}
+
+// Remove the event at index, keeping the heap order
+static void removeEvent(scheduler_t *scheduler, uint8_t index)
+{
+	scheduler->heap[index] = scheduler->heap[--scheduler->count];
+
+	if (index < scheduler->count) {
+		siftDown(scheduler, index);
+		siftUp(scheduler, index);
+	}
+}
+
+void scheduleEvent(scheduler_t *scheduler, uint8_t type, uint64_t time)
+{
+	for (uint8_t i = 0; i < scheduler->count; i++) {
+		if (scheduler->heap[i].type == type) {
+			removeEvent(scheduler, i);
+			break;
+		}
+	}
+
+	scheduler->heap[scheduler->count] = (event_t){ time, type };
+	siftUp(scheduler, scheduler->count++);
+}
+
+event_t popEvent(scheduler_t *scheduler)
+{
+	event_t event = scheduler->heap[0];
+
+	removeEvent(scheduler, 0);
+
+	return event;
+}
+
+uint64_t getEventTime(const scheduler_t *scheduler, uint8_t type)
+{
+	for (uint8_t i = 0; i < scheduler->count; i++) {
+		if (scheduler->heap[i].type == type) {
+			return scheduler->heap[i].time;
+		}
+	}
+
+	return EVENT_NEVER;
+}
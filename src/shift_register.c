@@ -1,21 +1,24 @@
 #include "shift_register.h"
 #include <stdint.h>
 
-static uint16_t shiftRegister = 0;
-static uint8_t shiftOffset = 0;
+void initShiftRegister(shift_register_t *shift)
+{
+	shift->value = 0;
+	shift->offset = 0;
+}
 
-void setShiftRegister(uint8_t data)
+void setShiftRegister(shift_register_t *shift, uint8_t data)
 {
-	shiftRegister = (shiftRegister >> 8) | (data << 8);
+	shift->value = (shift->value >> 8) | (data << 8);
 }
 
-void setShiftOffset(uint8_t offset)
+void setShiftOffset(shift_register_t *shift, uint8_t offset)
 {
-	shiftOffset = offset & 0x7;
+	shift->offset = offset & 0x7;
 }
 
-uint8_t getShiftRegister(void)
+uint8_t getShiftRegister(const shift_register_t *shift)
 {
-	uint16_t result = shiftRegister >> (8 - shiftOffset);
+	uint16_t result = shift->value >> (8 - shift->offset);
 	return (uint8_t)(result & 0xFF);
 }
@@ -0,0 +1,100 @@
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+
+#ifdef CPU_TRACE
+
+#define TRACE_PATH "trace.bin"
+
+// One flag for the process, the handler can't know the machines
+static volatile sig_atomic_t dumpRequested = 0;
+
+static void requestDump(int number)
+{
+	(void)number;
+	dumpRequested = 1;
+}
+
+trace_t *createTrace(void)
+{
+	trace_t *trace = malloc(sizeof(trace_t));
+
+	if (NULL == trace) {
+		fprintf(stderr, "Could not allocate the trace!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	trace->entries = malloc(TRACE_ENTRIES * sizeof(trace_entry_t));
+	trace->recorded = 0;
+
+	if (NULL == trace->entries) {
+		fprintf(stderr, "Could not allocate the trace!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	signal(SIGUSR2, requestDump);
+
+	return trace;
+}
+
+void destroyTrace(trace_t *trace)
+{
+	if (trace) {
+		free(trace->entries);
+		free(trace);
+	}
+}
+
+void writeTrace(const trace_t *trace)
+{
+	uint64_t count =
+		trace->recorded < TRACE_ENTRIES ? trace->recorded : TRACE_ENTRIES;
+	trace_header_t header = {
+		.magic = TRACE_MAGIC,
+		.version = TRACE_VERSION,
+		.entrySize = sizeof(trace_entry_t),
+		.count = count,
+		.first = trace->recorded - count,
+	};
+
+	// The oldest entry is the next one to be overwritten
+	uint64_t oldest = header.first & (TRACE_ENTRIES - 1);
+	uint64_t tail = count < TRACE_ENTRIES - oldest ? count :
+													 TRACE_ENTRIES - oldest;
+
+	FILE *file = fopen(TRACE_PATH, "wb");
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not create %s\n", TRACE_PATH);
+		return;
+	}
+
+	uint8_t result =
+		1 == fwrite(&header, sizeof(header), 1, file) &&
+		tail == fwrite(&trace->entries[oldest], sizeof(trace_entry_t), tail,
+					   file) &&
+		count - tail == fwrite(trace->entries, sizeof(trace_entry_t),
+							   count - tail, file);
+	fclose(file);
+
+	if (!result) {
+		fprintf(stderr, "Failed to write %s\n", TRACE_PATH);
+		return;
+	}
+
+	fprintf(stderr, "Last %llu instructions written to %s\n",
+			(unsigned long long)count, TRACE_PATH);
+}
+
+void pollTraceSignal(const trace_t *trace)
+{
+	if (dumpRequested) {
+		dumpRequested = 0;
+		writeTrace(trace);
+	}
+}
+
+#endif
@@ -0,0 +1,199 @@
+#include <stdint.h>
+
+#include "vram_convert.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VRAM_CONVERT_X86
+#include <immintrin.h>
+#endif
+
+// 32 bytes per VRAM row, one byte holds 8 pixels
+#define BYTES_PER_ROW (SCREEN_WIDTH / 8)
+
+typedef void (*stripe_kernel_t)(const uint8_t *vram, uint32_t *pixels,
+								int stripe);
+
+// First framebuffer row of the given bit within a stripe
+static uint32_t *getRow(uint32_t *pixels, int stripe, int bit)
+{
+	return &pixels[(SCREEN_WIDTH - 1 - (stripe * 8 + bit)) * SCREEN_HEIGHT];
+}
+
+/*
+ *  A stripe is a column in VRAM (stride of 32 bytes), gather it into a
+ *  contiguous buffer first so the vector kernels can use plain loads.
+ */
+static void gatherStripe(const uint8_t *vram, uint8_t *column, int stripe)
+{
+	for (int y = 0; y < SCREEN_HEIGHT; y++) {
+		column[y] = vram[y * BYTES_PER_ROW + stripe];
+	}
+}
+
+static void convertStripeScalar(const uint8_t *vram, uint32_t *pixels,
+								int stripe)
+{
+	uint8_t column[SCREEN_HEIGHT];
+	gatherStripe(vram, column, stripe);
+
+	for (int bit = 0; bit < 8; bit++) {
+		uint32_t *row = getRow(pixels, stripe, bit);
+
+		for (int y = 0; y < SCREEN_HEIGHT; y++) {
+			uint32_t lit = -(uint32_t)((column[y] >> bit) & 1);
+			row[y] = COLOR_OFF ^ ((COLOR_ON ^ COLOR_OFF) & lit);
+		}
+	}
+}
+
+#ifdef VRAM_CONVERT_X86
+
+// 16 pixels per iteration, SCREEN_HEIGHT is a multiple of 16
+__attribute__((target("sse2"))) static void
+convertStripeSSE2(const uint8_t *vram, uint32_t *pixels, int stripe)
+{
+	_Alignas(16) uint8_t column[SCREEN_HEIGHT];
+	gatherStripe(vram, column, stripe);
+
+	const __m128i off = _mm_set1_epi32((int)COLOR_OFF);
+	const __m128i diff = _mm_set1_epi32((int)(COLOR_ON ^ COLOR_OFF));
+
+	for (int bit = 0; bit < 8; bit++) {
+		uint32_t *row = getRow(pixels, stripe, bit);
+		const __m128i mask = _mm_set1_epi8((char)(1 << bit));
+
+		for (int y = 0; y < SCREEN_HEIGHT; y += 16) {
+			__m128i data = _mm_load_si128((const __m128i *)&column[y]);
+			// 0xFF for every lit pixel, 0x00 otherwise
+			__m128i lit = _mm_cmpeq_epi8(_mm_and_si128(data, mask), mask);
+
+			// Widen the byte masks to 32 bit
+			__m128i lo = _mm_unpacklo_epi8(lit, lit);
+			__m128i hi = _mm_unpackhi_epi8(lit, lit);
+			__m128i m0 = _mm_unpacklo_epi16(lo, lo);
+			__m128i m1 = _mm_unpackhi_epi16(lo, lo);
+			__m128i m2 = _mm_unpacklo_epi16(hi, hi);
+			__m128i m3 = _mm_unpackhi_epi16(hi, hi);
+
+			_mm_storeu_si128((__m128i *)&row[y + 0],
+							 _mm_xor_si128(off, _mm_and_si128(m0, diff)));
+			_mm_storeu_si128((__m128i *)&row[y + 4],
+							 _mm_xor_si128(off, _mm_and_si128(m1, diff)));
+			_mm_storeu_si128((__m128i *)&row[y + 8],
+							 _mm_xor_si128(off, _mm_and_si128(m2, diff)));
+			_mm_storeu_si128((__m128i *)&row[y + 12],
+							 _mm_xor_si128(off, _mm_and_si128(m3, diff)));
+		}
+	}
+}
+
+// 32 pixels per iteration, SCREEN_HEIGHT is a multiple of 32
+__attribute__((target("avx2"))) static void
+convertStripeAVX2(const uint8_t *vram, uint32_t *pixels, int stripe)
+{
+	_Alignas(32) uint8_t column[SCREEN_HEIGHT];
+	gatherStripe(vram, column, stripe);
+
+	const __m256i off = _mm256_set1_epi32((int)COLOR_OFF);
+	const __m256i diff = _mm256_set1_epi32((int)(COLOR_ON ^ COLOR_OFF));
+
+	for (int bit = 0; bit < 8; bit++) {
+		uint32_t *row = getRow(pixels, stripe, bit);
+		const __m256i mask = _mm256_set1_epi8((char)(1 << bit));
+
+		for (int y = 0; y < SCREEN_HEIGHT; y += 32) {
+			__m256i data = _mm256_load_si256((const __m256i *)&column[y]);
+			__m256i lit =
+				_mm256_cmpeq_epi8(_mm256_and_si256(data, mask), mask);
+
+			__m128i lo = _mm256_castsi256_si128(lit);
+			__m128i hi = _mm256_extracti128_si256(lit, 1);
+
+			// Sign extension turns 0xFF into 0xFFFFFFFF
+			__m256i m0 = _mm256_cvtepi8_epi32(lo);
+			__m256i m1 = _mm256_cvtepi8_epi32(_mm_srli_si128(lo, 8));
+			__m256i m2 = _mm256_cvtepi8_epi32(hi);
+			__m256i m3 = _mm256_cvtepi8_epi32(_mm_srli_si128(hi, 8));
+
+			_mm256_storeu_si256(
+				(__m256i *)&row[y + 0],
+				_mm256_xor_si256(off, _mm256_and_si256(m0, diff)));
+			_mm256_storeu_si256(
+				(__m256i *)&row[y + 8],
+				_mm256_xor_si256(off, _mm256_and_si256(m1, diff)));
+			_mm256_storeu_si256(
+				(__m256i *)&row[y + 16],
+				_mm256_xor_si256(off, _mm256_and_si256(m2, diff)));
+			_mm256_storeu_si256(
+				(__m256i *)&row[y + 24],
+				_mm256_xor_si256(off, _mm256_and_si256(m3, diff)));
+		}
+	}
+}
+
+#endif
+
+static stripe_kernel_t convertStripe = convertStripeScalar;
+static vram_kernel_t currentKernel = VRAM_KERNEL_SCALAR;
+
+int setVRAMKernel(vram_kernel_t kernel)
+{
+	switch (kernel) {
+	case VRAM_KERNEL_SCALAR:
+		convertStripe = convertStripeScalar;
+		break;
+#ifdef VRAM_CONVERT_X86
+	case VRAM_KERNEL_SSE2:
+		if (!__builtin_cpu_supports("sse2")) {
+			return 0;
+		}
+		convertStripe = convertStripeSSE2;
+		break;
+	case VRAM_KERNEL_AVX2:
+		if (!__builtin_cpu_supports("avx2")) {
+			return 0;
+		}
+		convertStripe = convertStripeAVX2;
+		break;
+#endif
+	default:
+		return 0;
+	}
+
+	currentKernel = kernel;
+	return 1;
+}
+
+void initVRAMConverter(void)
+{
+	if (!setVRAMKernel(VRAM_KERNEL_AVX2) && !setVRAMKernel(VRAM_KERNEL_SSE2)) {
+		setVRAMKernel(VRAM_KERNEL_SCALAR);
+	}
+}
+
+const char *getVRAMKernelName(void)
+{
+	switch (currentKernel) {
+	case VRAM_KERNEL_SSE2:
+		return "SSE2";
+	case VRAM_KERNEL_AVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
+
+void convertVRAMStripes(const uint8_t *vram, uint32_t *pixels,
+						uint32_t stripes)
+{
+	for (int stripe = 0; stripe < VRAM_STRIPES; stripe++) {
+		if (stripes & (1u << stripe)) {
+			convertStripe(vram, pixels, stripe);
+		}
+	}
+}
+
+void convertVRAM(const uint8_t *vram, uint32_t *pixels)
+{
+	convertVRAMStripes(vram, pixels, 0xFFFFFFFF);
+}
@@ -0,0 +1,2757 @@
+; Self-checking test of the 8080 instructions for tools/cpudiag.c, in the
+; style of the CP/M CPU exercisers. Every check compares the result and the
+; flags with the values of the 8080 data sheet and prints ERROR AT and the
+; address of the failed check. If every check passes, a CRC-16 over a long
+; byte sequence keeps the CPU busy for a few million cycles.
+;
+; Where the data sheet leaves the flags open, they are checked against the
+; 8080 itself: subtractions set the Auxiliary Carry if the low nibble does
+; not borrow, ANA and ANI set it to the OR of bit 3 of the operands.
+;
+; selftest.com is this file assembled with an 8080 assembler (Intel
+; mnemonics), loaded at 0100H.
+
+BDOS	EQU	0005H
+WBOOT	EQU	0000H
+
+	ORG	0100H
+
+	LXI	SP,STACK
+
+; Conditional jumps, calls and returns, taken and not taken
+	LXI	H,0046H
+	PUSH	H
+	POP	PSW
+	JZ	$+6
+	CALL	ERROR
+	JNZ	ERROR
+	CNZ	ERROR
+	MVI	B,0
+	CZ	SETB
+	DCR	B
+	CNZ	ERROR
+	LXI	H,0046H
+	PUSH	H
+	POP	PSW
+	CALL	RETZ
+	CALL	NORETNZ
+	JPE	$+6
+	CALL	ERROR
+	JPO	ERROR
+	CPO	ERROR
+	MVI	B,0
+	CPE	SETB
+	DCR	B
+	CNZ	ERROR
+	LXI	H,0046H
+	PUSH	H
+	POP	PSW
+	CALL	RETPE
+	CALL	NORETPO
+	JP	$+6
+	CALL	ERROR
+	JM	ERROR
+	CM	ERROR
+	MVI	B,0
+	CP	SETB
+	DCR	B
+	CNZ	ERROR
+	LXI	H,0046H
+	PUSH	H
+	POP	PSW
+	CALL	RETP
+	CALL	NORETM
+	JNC	$+6
+	CALL	ERROR
+	JC	ERROR
+	CC	ERROR
+	MVI	B,0
+	CNC	SETB
+	DCR	B
+	CNZ	ERROR
+	LXI	H,0046H
+	PUSH	H
+	POP	PSW
+	CALL	RETNC
+	CALL	NORETC
+	LXI	H,0083H
+	PUSH	H
+	POP	PSW
+	JNZ	$+6
+	CALL	ERROR
+	JZ	ERROR
+	CZ	ERROR
+	MVI	B,0
+	CNZ	SETB
+	DCR	B
+	CNZ	ERROR
+	LXI	H,0083H
+	PUSH	H
+	POP	PSW
+	CALL	RETNZ
+	CALL	NORETZ
+	JPO	$+6
+	CALL	ERROR
+	JPE	ERROR
+	CPE	ERROR
+	MVI	B,0
+	CPO	SETB
+	DCR	B
+	CNZ	ERROR
+	LXI	H,0083H
+	PUSH	H
+	POP	PSW
+	CALL	RETPO
+	CALL	NORETPE
+	JM	$+6
+	CALL	ERROR
+	JP	ERROR
+	CP	ERROR
+	MVI	B,0
+	CM	SETB
+	DCR	B
+	CNZ	ERROR
+	LXI	H,0083H
+	PUSH	H
+	POP	PSW
+	CALL	RETM
+	CALL	NORETP
+	JC	$+6
+	CALL	ERROR
+	JNC	ERROR
+	CNC	ERROR
+	MVI	B,0
+	CC	SETB
+	DCR	B
+	CNZ	ERROR
+	LXI	H,0083H
+	PUSH	H
+	POP	PSW
+	CALL	RETC
+	CALL	NORETNC
+
+; 8 bit arithmetic and logic, with registers, memory and immediates
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	MVI	E,0C6H
+	ADD	E
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	LXI	H,DATA
+	MVI	M,0C6H
+	ADD	M
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	ADI	01H
+	LXI	D,8092H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	MVI	E,01H
+	ADD	E
+	LXI	D,8092H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	LXI	H,DATA
+	MVI	M,80H
+	ADD	M
+	LXI	D,0047H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	ADI	80H
+	LXI	D,0047H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	MVI	E,01H
+	ADD	E
+	LXI	D,1012H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,01H
+	ADD	M
+	LXI	D,1012H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	ADI	00H
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,00H
+	ADD	E
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	LXI	H,DATA
+	MVI	M,67H
+	ADD	M
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	ADI	67H
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	MVI	E,0FEH
+	ADD	E
+	LXI	D,0FD93H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	LXI	H,DATA
+	MVI	M,0FEH
+	ADD	M
+	LXI	D,0FD93H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	ADI	0FFH
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,0FFH
+	ADD	E
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	LXI	H,DATA
+	MVI	M,0FFH
+	ADD	M
+	LXI	D,1117H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	ADI	0FFH
+	LXI	D,1117H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	MVI	E,01H
+	ADD	E
+	LXI	D,1106H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	LXI	H,DATA
+	MVI	M,01H
+	ADD	M
+	LXI	D,1106H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	ADI	07H
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	MVI	E,07H
+	ADD	E
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,0FH
+	ADD	M
+	LXI	D,1E16H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	ADI	0FH
+	LXI	D,1E16H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	MVI	E,0C6H
+	ADC	E
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	LXI	H,DATA
+	MVI	M,0C6H
+	ADC	M
+	LXI	D,0113H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	ACI	01H
+	LXI	D,8092H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	MVI	E,01H
+	ADC	E
+	LXI	D,8196H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	LXI	H,DATA
+	MVI	M,80H
+	ADC	M
+	LXI	D,0047H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	ACI	80H
+	LXI	D,0103H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	MVI	E,01H
+	ADC	E
+	LXI	D,1012H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,01H
+	ADC	M
+	LXI	D,1116H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	ACI	00H
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,00H
+	ADC	E
+	LXI	D,0102H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	LXI	H,DATA
+	MVI	M,67H
+	ADC	M
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	ACI	67H
+	LXI	D,0113H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	MVI	E,0FEH
+	ADC	E
+	LXI	D,0FD93H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	LXI	H,DATA
+	MVI	M,0FEH
+	ADC	M
+	LXI	D,0FE93H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	ACI	0FFH
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,0FFH
+	ADC	E
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	LXI	H,DATA
+	MVI	M,0FFH
+	ADC	M
+	LXI	D,1117H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	ACI	0FFH
+	LXI	D,1217H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	MVI	E,01H
+	ADC	E
+	LXI	D,1106H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	LXI	H,DATA
+	MVI	M,01H
+	ADC	M
+	LXI	D,1206H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	ACI	07H
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	MVI	E,07H
+	ADC	E
+	LXI	D,1012H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,0FH
+	ADC	M
+	LXI	D,1E16H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	ACI	0FH
+	LXI	D,1F12H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	MVI	E,0C6H
+	SUB	E
+	LXI	D,7417H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	LXI	H,DATA
+	MVI	M,0C6H
+	SUB	M
+	LXI	D,7417H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	SUI	01H
+	LXI	D,7E16H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	MVI	E,01H
+	SUB	E
+	LXI	D,7E16H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	LXI	H,DATA
+	MVI	M,80H
+	SUB	M
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	SUI	80H
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	MVI	E,01H
+	SUB	E
+	LXI	D,0E12H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,01H
+	SUB	M
+	LXI	D,0E12H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	SUI	00H
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,00H
+	SUB	E
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	LXI	H,DATA
+	MVI	M,67H
+	SUB	M
+	LXI	D,3212H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	SUI	67H
+	LXI	D,3212H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	MVI	E,0FEH
+	SUB	E
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	LXI	H,DATA
+	MVI	M,0FEH
+	SUB	M
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	SUI	0FFH
+	LXI	D,0103H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,0FFH
+	SUB	E
+	LXI	D,0103H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	LXI	H,DATA
+	MVI	M,0FFH
+	SUB	M
+	LXI	D,1303H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	SUI	0FFH
+	LXI	D,1303H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	MVI	E,01H
+	SUB	E
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	LXI	H,DATA
+	MVI	M,01H
+	SUB	M
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	SUI	07H
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	MVI	E,07H
+	SUB	E
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,0FH
+	SUB	M
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	SUI	0FH
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	MVI	E,0C6H
+	SBB	E
+	LXI	D,7417H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	LXI	H,DATA
+	MVI	M,0C6H
+	SBB	M
+	LXI	D,7313H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	SBI	01H
+	LXI	D,7E16H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	MVI	E,01H
+	SBB	E
+	LXI	D,7D16H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	LXI	H,DATA
+	MVI	M,80H
+	SBB	M
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	SBI	80H
+	LXI	D,0FF87H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	MVI	E,01H
+	SBB	E
+	LXI	D,0E12H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,01H
+	SBB	M
+	LXI	D,0D12H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	SBI	00H
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,00H
+	SBB	E
+	LXI	D,0FF87H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	LXI	H,DATA
+	MVI	M,67H
+	SBB	M
+	LXI	D,3212H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	SBI	67H
+	LXI	D,3112H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	MVI	E,0FEH
+	SBB	E
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	LXI	H,DATA
+	MVI	M,0FEH
+	SBB	M
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	SBI	0FFH
+	LXI	D,0103H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,0FFH
+	SBB	E
+	LXI	D,0047H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	LXI	H,DATA
+	MVI	M,0FFH
+	SBB	M
+	LXI	D,1303H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	SBI	0FFH
+	LXI	D,1207H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	MVI	E,01H
+	SBB	E
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	LXI	H,DATA
+	MVI	M,01H
+	SBB	M
+	LXI	D,0E02H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	SBI	07H
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	MVI	E,07H
+	SBB	E
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,0FH
+	SBB	M
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	SBI	0FH
+	LXI	D,0FF87H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	MVI	E,0C6H
+	ANA	E
+	LXI	D,0212H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	LXI	H,DATA
+	MVI	M,0C6H
+	ANA	M
+	LXI	D,0212H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	ANI	01H
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	MVI	E,01H
+	ANA	E
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	LXI	H,DATA
+	MVI	M,80H
+	ANA	M
+	LXI	D,8082H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	ANI	80H
+	LXI	D,8082H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	MVI	E,01H
+	ANA	E
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,01H
+	ANA	M
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	ANI	00H
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,00H
+	ANA	E
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	LXI	H,DATA
+	MVI	M,67H
+	ANA	M
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	ANI	67H
+	LXI	D,0112H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	MVI	E,0FEH
+	ANA	E
+	LXI	D,0FE92H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	LXI	H,DATA
+	MVI	M,0FEH
+	ANA	M
+	LXI	D,0FE92H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	ANI	0FFH
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,0FFH
+	ANA	E
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	LXI	H,DATA
+	MVI	M,0FFH
+	ANA	M
+	LXI	D,1216H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	ANI	0FFH
+	LXI	D,1216H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	MVI	E,01H
+	ANA	E
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	LXI	H,DATA
+	MVI	M,01H
+	ANA	M
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	ANI	07H
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	MVI	E,07H
+	ANA	E
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,0FH
+	ANA	M
+	LXI	D,0F16H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	ANI	0FH
+	LXI	D,0F16H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	MVI	E,0C6H
+	XRA	E
+	LXI	D,0FC86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	LXI	H,DATA
+	MVI	M,0C6H
+	XRA	M
+	LXI	D,0FC86H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	XRI	01H
+	LXI	D,7E06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	MVI	E,01H
+	XRA	E
+	LXI	D,7E06H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	LXI	H,DATA
+	MVI	M,80H
+	XRA	M
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	XRI	80H
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	MVI	E,01H
+	XRA	E
+	LXI	D,0E02H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,01H
+	XRA	M
+	LXI	D,0E02H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	XRI	00H
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,00H
+	XRA	E
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	LXI	H,DATA
+	MVI	M,67H
+	XRA	M
+	LXI	D,0FE82H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	XRI	67H
+	LXI	D,0FE82H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	MVI	E,0FEH
+	XRA	E
+	LXI	D,0102H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	LXI	H,DATA
+	MVI	M,0FEH
+	XRA	M
+	LXI	D,0102H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	XRI	0FFH
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,0FFH
+	XRA	E
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	LXI	H,DATA
+	MVI	M,0FFH
+	XRA	M
+	LXI	D,0ED86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	XRI	0FFH
+	LXI	D,0ED86H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	MVI	E,01H
+	XRA	E
+	LXI	D,1106H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	LXI	H,DATA
+	MVI	M,01H
+	XRA	M
+	LXI	D,1106H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	XRI	07H
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	MVI	E,07H
+	XRA	E
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,0FH
+	XRA	M
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	XRI	0FH
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	MVI	E,0C6H
+	ORA	E
+	LXI	D,0FE82H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	LXI	H,DATA
+	MVI	M,0C6H
+	ORA	M
+	LXI	D,0FE82H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	ORI	01H
+	LXI	D,7F02H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	MVI	E,01H
+	ORA	E
+	LXI	D,7F02H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	LXI	H,DATA
+	MVI	M,80H
+	ORA	M
+	LXI	D,8082H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	ORI	80H
+	LXI	D,8082H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	MVI	E,01H
+	ORA	E
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,01H
+	ORA	M
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	ORI	00H
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,00H
+	ORA	E
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	LXI	H,DATA
+	MVI	M,67H
+	ORA	M
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	ORI	67H
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	MVI	E,0FEH
+	ORA	E
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	LXI	H,DATA
+	MVI	M,0FEH
+	ORA	M
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	ORI	0FFH
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,0FFH
+	ORA	E
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	LXI	H,DATA
+	MVI	M,0FFH
+	ORA	M
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	ORI	0FFH
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	MVI	E,01H
+	ORA	E
+	LXI	D,1106H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	LXI	H,DATA
+	MVI	M,01H
+	ORA	M
+	LXI	D,1106H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	ORI	07H
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	MVI	E,07H
+	ORA	E
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,0FH
+	ORA	M
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	ORI	0FH
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	MVI	E,0C6H
+	CMP	E
+	LXI	D,3A17H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,3AH
+	LXI	H,DATA
+	MVI	M,0C6H
+	CMP	M
+	LXI	D,3A17H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	CPI	01H
+	LXI	D,7F16H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	MVI	E,01H
+	CMP	E
+	LXI	D,7F16H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	LXI	H,DATA
+	MVI	M,80H
+	CMP	M
+	LXI	D,8056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	CPI	80H
+	LXI	D,8056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	MVI	E,01H
+	CMP	E
+	LXI	D,0F12H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,01H
+	CMP	M
+	LXI	D,0F12H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	CPI	00H
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,00H
+	CMP	E
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	LXI	H,DATA
+	MVI	M,67H
+	CMP	M
+	LXI	D,9912H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	CPI	67H
+	LXI	D,9912H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	MVI	E,0FEH
+	CMP	E
+	LXI	D,0FF12H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	LXI	H,DATA
+	MVI	M,0FEH
+	CMP	M
+	LXI	D,0FF12H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	CPI	0FFH
+	LXI	D,0003H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	MVI	E,0FFH
+	CMP	E
+	LXI	D,0003H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	LXI	H,DATA
+	MVI	M,0FFH
+	CMP	M
+	LXI	D,1203H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,12H
+	CPI	0FFH
+	LXI	D,1203H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	MVI	E,01H
+	CMP	E
+	LXI	D,1006H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	LXI	H,DATA
+	MVI	M,01H
+	CMP	M
+	LXI	D,1006H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	CPI	07H
+	LXI	D,0812H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,08H
+	MVI	E,07H
+	CMP	E
+	LXI	D,0812H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	LXI	H,DATA
+	MVI	M,0FH
+	CMP	M
+	LXI	D,0F56H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	CPI	0FH
+	LXI	D,0F56H
+	CALL	CHKAF
+
+; INR and DCR keep the Carry
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	INR	A
+	LXI	D,0102H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,00H
+	DCR	M
+	MOV	A,M
+	LXI	D,0FF86H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	INR	A
+	LXI	D,0103H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,00H
+	DCR	M
+	MOV	A,M
+	LXI	D,0FF87H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	INR	A
+	LXI	D,1012H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,0FH
+	DCR	M
+	MOV	A,M
+	LXI	D,0E12H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FH
+	INR	A
+	LXI	D,1013H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,0FH
+	DCR	M
+	MOV	A,M
+	LXI	D,0E13H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	INR	A
+	LXI	D,8092H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,7FH
+	DCR	M
+	MOV	A,M
+	LXI	D,7E16H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,7FH
+	INR	A
+	LXI	D,8093H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,7FH
+	DCR	M
+	MOV	A,M
+	LXI	D,7E17H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	INR	A
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,0FFH
+	DCR	M
+	MOV	A,M
+	LXI	D,0FE92H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,0FFH
+	INR	A
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,0FFH
+	DCR	M
+	MOV	A,M
+	LXI	D,0FE93H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	INR	A
+	LXI	D,1106H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,10H
+	DCR	M
+	MOV	A,M
+	LXI	D,0F06H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,10H
+	INR	A
+	LXI	D,1107H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,10H
+	DCR	M
+	MOV	A,M
+	LXI	D,0F07H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	INR	A
+	LXI	D,8186H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,80H
+	DCR	M
+	MOV	A,M
+	LXI	D,7F02H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,80H
+	INR	A
+	LXI	D,8187H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,80H
+	DCR	M
+	MOV	A,M
+	LXI	D,7F03H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,01H
+	INR	A
+	LXI	D,0202H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,01H
+	DCR	M
+	MOV	A,M
+	LXI	D,0056H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	MVI	A,01H
+	INR	A
+	LXI	D,0203H
+	CALL	CHKAF
+	LXI	H,0003H
+	PUSH	H
+	POP	PSW
+	LXI	H,DATA
+	MVI	M,01H
+	DCR	M
+	MOV	A,M
+	LXI	D,0057H
+	CALL	CHKAF
+
+; DAA after additions
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,15H
+	ADI	27H
+	DAA
+	LXI	D,4216H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,19H
+	ADI	28H
+	DAA
+	LXI	D,4706H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,99H
+	ADI	01H
+	DAA
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,50H
+	ADI	50H
+	DAA
+	LXI	D,0047H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,09H
+	ADI	09H
+	DAA
+	LXI	D,1806H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,45H
+	ADI	55H
+	DAA
+	LXI	D,0057H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,05H
+	ADI	05H
+	DAA
+	LXI	D,1012H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,90H
+	ADI	90H
+	DAA
+	LXI	D,8083H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,00H
+	ADI	00H
+	DAA
+	LXI	D,0046H
+	CALL	CHKAF
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	MVI	A,88H
+	ADI	88H
+	DAA
+	LXI	D,7603H
+	CALL	CHKAF
+
+; Rotates only change the Carry, CMA and CMC none of the others
+	LXI	H,81D6H
+	PUSH	H
+	POP	PSW
+	RLC
+	LXI	D,03D7H
+	CALL	CHKAF
+	LXI	H,81D6H
+	PUSH	H
+	POP	PSW
+	RRC
+	LXI	D,0C0D7H
+	CALL	CHKAF
+	LXI	H,81D6H
+	PUSH	H
+	POP	PSW
+	RAL
+	LXI	D,02D7H
+	CALL	CHKAF
+	LXI	H,81D6H
+	PUSH	H
+	POP	PSW
+	RAR
+	LXI	D,40D7H
+	CALL	CHKAF
+	LXI	H,81D6H
+	PUSH	H
+	POP	PSW
+	CMA
+	LXI	D,7ED6H
+	CALL	CHKAF
+	LXI	H,81D6H
+	PUSH	H
+	POP	PSW
+	STC
+	LXI	D,81D7H
+	CALL	CHKAF
+	LXI	H,81D6H
+	PUSH	H
+	POP	PSW
+	CMC
+	LXI	D,81D7H
+	CALL	CHKAF
+	LXI	H,81D7H
+	PUSH	H
+	POP	PSW
+	RLC
+	LXI	D,03D7H
+	CALL	CHKAF
+	LXI	H,81D7H
+	PUSH	H
+	POP	PSW
+	RRC
+	LXI	D,0C0D7H
+	CALL	CHKAF
+	LXI	H,81D7H
+	PUSH	H
+	POP	PSW
+	RAL
+	LXI	D,03D7H
+	CALL	CHKAF
+	LXI	H,81D7H
+	PUSH	H
+	POP	PSW
+	RAR
+	LXI	D,0C0D7H
+	CALL	CHKAF
+	LXI	H,81D7H
+	PUSH	H
+	POP	PSW
+	CMA
+	LXI	D,7ED7H
+	CALL	CHKAF
+	LXI	H,81D7H
+	PUSH	H
+	POP	PSW
+	STC
+	LXI	D,81D7H
+	CALL	CHKAF
+	LXI	H,81D7H
+	PUSH	H
+	POP	PSW
+	CMC
+	LXI	D,81D6H
+	CALL	CHKAF
+	LXI	H,42D6H
+	PUSH	H
+	POP	PSW
+	RLC
+	LXI	D,84D6H
+	CALL	CHKAF
+	LXI	H,42D6H
+	PUSH	H
+	POP	PSW
+	RRC
+	LXI	D,21D6H
+	CALL	CHKAF
+	LXI	H,42D6H
+	PUSH	H
+	POP	PSW
+	RAL
+	LXI	D,84D6H
+	CALL	CHKAF
+	LXI	H,42D6H
+	PUSH	H
+	POP	PSW
+	RAR
+	LXI	D,21D6H
+	CALL	CHKAF
+	LXI	H,42D6H
+	PUSH	H
+	POP	PSW
+	CMA
+	LXI	D,0BDD6H
+	CALL	CHKAF
+	LXI	H,42D6H
+	PUSH	H
+	POP	PSW
+	STC
+	LXI	D,42D7H
+	CALL	CHKAF
+	LXI	H,42D6H
+	PUSH	H
+	POP	PSW
+	CMC
+	LXI	D,42D7H
+	CALL	CHKAF
+	LXI	H,42D7H
+	PUSH	H
+	POP	PSW
+	RLC
+	LXI	D,84D6H
+	CALL	CHKAF
+	LXI	H,42D7H
+	PUSH	H
+	POP	PSW
+	RRC
+	LXI	D,21D6H
+	CALL	CHKAF
+	LXI	H,42D7H
+	PUSH	H
+	POP	PSW
+	RAL
+	LXI	D,85D6H
+	CALL	CHKAF
+	LXI	H,42D7H
+	PUSH	H
+	POP	PSW
+	RAR
+	LXI	D,0A1D6H
+	CALL	CHKAF
+	LXI	H,42D7H
+	PUSH	H
+	POP	PSW
+	CMA
+	LXI	D,0BDD7H
+	CALL	CHKAF
+	LXI	H,42D7H
+	PUSH	H
+	POP	PSW
+	STC
+	LXI	D,42D7H
+	CALL	CHKAF
+	LXI	H,42D7H
+	PUSH	H
+	POP	PSW
+	CMC
+	LXI	D,42D6H
+	CALL	CHKAF
+
+; POP PSW only loads the flags, the unused bits read as 0 and bit 1 as 1
+	LXI	H,12FFH
+	PUSH	H
+	POP	PSW
+	PUSH	PSW
+	POP	H
+	MOV	A,H
+	CPI	12H
+	CNZ	ERROR
+	MOV	A,L
+	CPI	0D7H
+	CNZ	ERROR
+	LXI	H,3400H
+	PUSH	H
+	POP	PSW
+	PUSH	PSW
+	POP	H
+	MOV	A,L
+	CPI	02H
+	CNZ	ERROR
+
+; RST calls n * 8 and returns behind itself
+	MVI	A,0C3H
+	STA	0008H
+	STA	0038H
+	LXI	H,RSTCHK1
+	SHLD	0009H
+	LXI	H,RSTCHK7
+	SHLD	0039H
+	MVI	B,0
+	RST	1
+RSTRET1:
+	RST	7
+RSTRET7:
+	MOV	A,B
+	CPI	2
+	CNZ	ERROR
+
+; 16 bit arithmetic, DAD only changes the Carry
+	LXI	H,0FFD6H
+	PUSH	H
+	POP	PSW
+	LXI	H,8001H
+	LXI	B,8000H
+	DAD	B
+	PUSH	H
+	LXI	D,0FFD7H
+	CALL	CHKAF
+	POP	H
+	MOV	A,H
+	CPI	00H
+	CNZ	ERROR
+	MOV	A,L
+	CPI	01H
+	CNZ	ERROR
+	LXI	H,0002H
+	PUSH	H
+	POP	PSW
+	LXI	H,1234H
+	DAD	H
+	PUSH	H
+	LXI	D,0002H
+	CALL	CHKAF
+	POP	H
+	MOV	A,H
+	CPI	24H
+	CNZ	ERROR
+	MOV	A,L
+	CPI	68H
+	CNZ	ERROR
+	LXI	SP,STACK
+	LXI	H,0
+	DAD	SP
+	MOV	A,H
+	CPI	STACK/256
+	CNZ	ERROR
+	MOV	A,L
+	CPI	STACK-STACK/256*256
+	CNZ	ERROR
+	LXI	B,0FFFFH
+	INX	B
+	MOV	A,B
+	ORA	C
+	CNZ	ERROR
+	LXI	D,0
+	DCX	D
+	MOV	A,D
+	ANA	E
+	CPI	0FFH
+	CNZ	ERROR
+
+; Loads, stores and exchanges
+	MVI	A,5AH
+	STA	DATA
+	XRA	A
+	LDA	DATA
+	CPI	5AH
+	CNZ	ERROR
+	LXI	H,1357H
+	SHLD	DATA
+	LXI	H,0
+	LHLD	DATA
+	MOV	A,H
+	CPI	13H
+	CNZ	ERROR
+	MOV	A,L
+	CPI	57H
+	CNZ	ERROR
+	LXI	B,DATA
+	MVI	A,0A5H
+	STAX	B
+	LXI	D,DATA
+	XRA	A
+	LDAX	D
+	CPI	0A5H
+	CNZ	ERROR
+	LXI	D,1122H
+	LXI	H,3344H
+	XCHG
+	MOV	A,D
+	CPI	33H
+	CNZ	ERROR
+	MOV	A,L
+	CPI	22H
+	CNZ	ERROR
+	LXI	H,0ABCDH
+	PUSH	H
+	LXI	H,6789H
+	XTHL
+	MOV	A,H
+	CPI	0ABH
+	CNZ	ERROR
+	POP	H
+	MOV	A,L
+	CPI	89H
+	CNZ	ERROR
+	LXI	B,0102H
+	LXI	D,0304H
+	LXI	H,0506H
+	PUSH	B
+	PUSH	D
+	PUSH	H
+	POP	B
+	POP	H
+	POP	D
+	MOV	A,B
+	CPI	05H
+	CNZ	ERROR
+	MOV	A,L
+	CPI	04H
+	CNZ	ERROR
+	MOV	A,D
+	CPI	01H
+	CNZ	ERROR
+	LXI	H,STACK-16
+	SPHL
+	LXI	H,0
+	DAD	SP
+	MOV	A,L
+	CPI	STACK-16-STACK/256*256
+	CNZ	ERROR
+	LXI	SP,STACK
+	LXI	H,PCHLOK
+	PCHL
+	CALL	ERROR
+PCHLOK:
+
+; Every MOV between registers
+
+	MVI	C,0A0H
+	MOV	B,C
+	MOV	A,B
+	CPI	0A0H
+	CNZ	ERROR
+	MVI	D,0A0H
+	MOV	B,D
+	MOV	A,B
+	CPI	0A0H
+	CNZ	ERROR
+	MVI	E,0A0H
+	MOV	B,E
+	MOV	A,B
+	CPI	0A0H
+	CNZ	ERROR
+	MVI	H,0A0H
+	MOV	B,H
+	MOV	A,B
+	CPI	0A0H
+	CNZ	ERROR
+	MVI	L,0A0H
+	MOV	B,L
+	MOV	A,B
+	CPI	0A0H
+	CNZ	ERROR
+	MVI	A,0A0H
+	MOV	B,A
+	MOV	A,B
+	CPI	0A0H
+	CNZ	ERROR
+	MVI	B,0A1H
+	MOV	C,B
+	MOV	A,C
+	CPI	0A1H
+	CNZ	ERROR
+	MVI	D,0A1H
+	MOV	C,D
+	MOV	A,C
+	CPI	0A1H
+	CNZ	ERROR
+	MVI	E,0A1H
+	MOV	C,E
+	MOV	A,C
+	CPI	0A1H
+	CNZ	ERROR
+	MVI	H,0A1H
+	MOV	C,H
+	MOV	A,C
+	CPI	0A1H
+	CNZ	ERROR
+	MVI	L,0A1H
+	MOV	C,L
+	MOV	A,C
+	CPI	0A1H
+	CNZ	ERROR
+	MVI	A,0A1H
+	MOV	C,A
+	MOV	A,C
+	CPI	0A1H
+	CNZ	ERROR
+	MVI	B,0A2H
+	MOV	D,B
+	MOV	A,D
+	CPI	0A2H
+	CNZ	ERROR
+	MVI	C,0A2H
+	MOV	D,C
+	MOV	A,D
+	CPI	0A2H
+	CNZ	ERROR
+	MVI	E,0A2H
+	MOV	D,E
+	MOV	A,D
+	CPI	0A2H
+	CNZ	ERROR
+	MVI	H,0A2H
+	MOV	D,H
+	MOV	A,D
+	CPI	0A2H
+	CNZ	ERROR
+	MVI	L,0A2H
+	MOV	D,L
+	MOV	A,D
+	CPI	0A2H
+	CNZ	ERROR
+	MVI	A,0A2H
+	MOV	D,A
+	MOV	A,D
+	CPI	0A2H
+	CNZ	ERROR
+	MVI	B,0A3H
+	MOV	E,B
+	MOV	A,E
+	CPI	0A3H
+	CNZ	ERROR
+	MVI	C,0A3H
+	MOV	E,C
+	MOV	A,E
+	CPI	0A3H
+	CNZ	ERROR
+	MVI	D,0A3H
+	MOV	E,D
+	MOV	A,E
+	CPI	0A3H
+	CNZ	ERROR
+	MVI	H,0A3H
+	MOV	E,H
+	MOV	A,E
+	CPI	0A3H
+	CNZ	ERROR
+	MVI	L,0A3H
+	MOV	E,L
+	MOV	A,E
+	CPI	0A3H
+	CNZ	ERROR
+	MVI	A,0A3H
+	MOV	E,A
+	MOV	A,E
+	CPI	0A3H
+	CNZ	ERROR
+	MVI	B,0A4H
+	MOV	H,B
+	MOV	A,H
+	CPI	0A4H
+	CNZ	ERROR
+	MVI	C,0A4H
+	MOV	H,C
+	MOV	A,H
+	CPI	0A4H
+	CNZ	ERROR
+	MVI	D,0A4H
+	MOV	H,D
+	MOV	A,H
+	CPI	0A4H
+	CNZ	ERROR
+	MVI	E,0A4H
+	MOV	H,E
+	MOV	A,H
+	CPI	0A4H
+	CNZ	ERROR
+	MVI	L,0A4H
+	MOV	H,L
+	MOV	A,H
+	CPI	0A4H
+	CNZ	ERROR
+	MVI	A,0A4H
+	MOV	H,A
+	MOV	A,H
+	CPI	0A4H
+	CNZ	ERROR
+	MVI	B,0A5H
+	MOV	L,B
+	MOV	A,L
+	CPI	0A5H
+	CNZ	ERROR
+	MVI	C,0A5H
+	MOV	L,C
+	MOV	A,L
+	CPI	0A5H
+	CNZ	ERROR
+	MVI	D,0A5H
+	MOV	L,D
+	MOV	A,L
+	CPI	0A5H
+	CNZ	ERROR
+	MVI	E,0A5H
+	MOV	L,E
+	MOV	A,L
+	CPI	0A5H
+	CNZ	ERROR
+	MVI	H,0A5H
+	MOV	L,H
+	MOV	A,L
+	CPI	0A5H
+	CNZ	ERROR
+	MVI	A,0A5H
+	MOV	L,A
+	MOV	A,L
+	CPI	0A5H
+	CNZ	ERROR
+	MVI	B,0A6H
+	MOV	A,B
+	NOP
+	CPI	0A6H
+	CNZ	ERROR
+	MVI	C,0A6H
+	MOV	A,C
+	NOP
+	CPI	0A6H
+	CNZ	ERROR
+	MVI	D,0A6H
+	MOV	A,D
+	NOP
+	CPI	0A6H
+	CNZ	ERROR
+	MVI	E,0A6H
+	MOV	A,E
+	NOP
+	CPI	0A6H
+	CNZ	ERROR
+	MVI	H,0A6H
+	MOV	A,H
+	NOP
+	CPI	0A6H
+	CNZ	ERROR
+	MVI	L,0A6H
+	MOV	A,L
+	NOP
+	CPI	0A6H
+	CNZ	ERROR
+	LXI	H,DATA
+	MVI	B,30H
+	MOV	M,B
+	MVI	A,0
+	MOV	B,M
+	MOV	A,B
+	CPI	30H
+	CNZ	ERROR
+	LXI	H,DATA
+	MVI	C,31H
+	MOV	M,C
+	MVI	A,0
+	MOV	C,M
+	MOV	A,C
+	CPI	31H
+	CNZ	ERROR
+	LXI	H,DATA
+	MVI	D,32H
+	MOV	M,D
+	MVI	A,0
+	MOV	D,M
+	MOV	A,D
+	CPI	32H
+	CNZ	ERROR
+	LXI	H,DATA
+	MVI	E,33H
+	MOV	M,E
+	MVI	A,0
+	MOV	E,M
+	MOV	A,E
+	CPI	33H
+	CNZ	ERROR
+	LXI	H,DATA
+	MVI	A,36H
+	MOV	M,A
+	MVI	A,0
+	MOV	A,M
+	NOP
+	CPI	36H
+	CNZ	ERROR
+
+; CRC-16 (polynomial 1021H) of the bytes 0, 1, ... 255, 0, 1, ...
+	LXI	H,0FFFFH
+	LXI	D,3000H
+	MVI	C,0
+CRCLOOP:
+	MOV	A,C
+	CALL	CRCBYTE
+	INR	C
+	DCX	D
+	MOV	A,D
+	ORA	E
+	JNZ	CRCLOOP
+	MOV	A,H
+	CPI	0CH
+	CNZ	ERROR
+	MOV	A,L
+	CPI	5FH
+	CNZ	ERROR
+
+	LXI	D,OKMSG
+	MVI	C,9
+	CALL	BDOS
+	JMP	WBOOT
+
+; Update the CRC in HL with the byte in A, changes A and B
+CRCBYTE:
+	XRA	H
+	MOV	H,A
+	MVI	B,8
+CRCBIT:
+	DAD	H
+	JNC	CRCNEXT
+	MOV	A,H
+	XRI	10H
+	MOV	H,A
+	MOV	A,L
+	XRI	21H
+	MOV	L,A
+CRCNEXT:
+	DCR	B
+	JNZ	CRCBIT
+	RET
+
+; Compare A and the flags with D and E, changes HL
+CHKAF:
+	PUSH	PSW
+	POP	H
+	MOV	A,H
+	CMP	D
+	JNZ	CHKERR
+	MOV	A,L
+	CMP	E
+	RZ
+CHKERR:
+	POP	H
+	JMP	ERRHL
+
+; Targets of RST 1 and RST 7, check the return address and count in B
+RSTCHK1:
+	LXI	D,RSTRET1
+	JMP	RSTCHK
+RSTCHK7:
+	LXI	D,RSTRET7
+RSTCHK:
+	POP	H
+	PUSH	H
+	MOV	A,H
+	CMP	D
+	JNZ	ERROR
+	MOV	A,L
+	CMP	E
+	JNZ	ERROR
+	INR	B
+	RET
+
+SETB:
+	MVI	B,1
+	RET
+
+; RZ has to return, RNZ must not
+RETZ:
+	RZ
+	JMP	ERROR
+NORETNZ:
+	RNZ
+	RET
+
+; RNZ has to return, RZ must not
+RETNZ:
+	RNZ
+	JMP	ERROR
+NORETZ:
+	RZ
+	RET
+
+; RPE has to return, RPO must not
+RETPE:
+	RPE
+	JMP	ERROR
+NORETPO:
+	RPO
+	RET
+
+; RPO has to return, RPE must not
+RETPO:
+	RPO
+	JMP	ERROR
+NORETPE:
+	RPE
+	RET
+
+; RP has to return, RM must not
+RETP:
+	RP
+	JMP	ERROR
+NORETM:
+	RM
+	RET
+
+; RM has to return, RP must not
+RETM:
+	RM
+	JMP	ERROR
+NORETP:
+	RP
+	RET
+
+; RC has to return, RNC must not
+RETC:
+	RC
+	JMP	ERROR
+NORETNC:
+	RNC
+	RET
+
+; RNC has to return, RC must not
+RETNC:
+	RNC
+	JMP	ERROR
+NORETC:
+	RC
+	RET
+
+; Print ERROR AT and the address the check was called from, then return
+; to CP/M
+ERROR:
+	POP	H
+ERRHL:
+	DCX	H
+	DCX	H
+	DCX	H
+	PUSH	H
+	LXI	D,ERRMSG
+	MVI	C,9
+	CALL	BDOS
+	POP	H
+	MOV	A,H
+	CALL	PHEX
+	MOV	A,L
+	CALL	PHEX
+	JMP	WBOOT
+
+; Print A as two hex digits
+PHEX:
+	PUSH	PSW
+	RRC
+	RRC
+	RRC
+	RRC
+	CALL	PDIGIT
+	POP	PSW
+PDIGIT:
+	ANI	0FH
+	ADI	90H
+	DAA
+	ACI	40H
+	DAA
+	MOV	E,A
+	MVI	C,2
+	PUSH	H
+	CALL	BDOS
+	POP	H
+	RET
+
+OKMSG:	DB	'CPU IS OPERATIONAL$'
+ERRMSG:	DB	'ERROR AT $'
+DATA:	DS	2
+	DS	64
+STACK:
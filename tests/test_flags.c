@@ -0,0 +1,234 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cpu.h"
+#include "flags.h"
+
+/*
+ *  Checks the flag tables and helpers of flags.h, eager and lazy, against
+ *  the arithmetic of the 8080 (below), for all operand pairs, carry-in
+ *  values and both settings of the other flags.
+ */
+
+// The flags before the instruction: none set, or all of them
+static const uint8_t initialFlags[] = { 0x02, 0x02 | FLAGS_ALL };
+
+static int failures = 0;
+
+// Reference implementation, one bit at a time like the 8080 does it
+
+static void refSet(uint8_t *f, uint8_t flag, int set)
+{
+	*f = set ? *f | flag : *f & ~flag;
+}
+
+static void refParity(uint8_t *f, uint8_t byte)
+{
+	uint8_t count = 0;
+
+	for (int i = 0; i < 8; i++) {
+		if (byte & (1 << i)) {
+			count++;
+		}
+	}
+
+	refSet(f, PARITY, count % 2 == 0);
+}
+
+static void refSZP(uint8_t *f, uint8_t byte)
+{
+	refSet(f, ZERO, byte == 0);
+	refSet(f, SIGN, byte & 0x80);
+	refParity(f, byte);
+}
+
+// ADD/ADC and SUB/SBB. Subtractions add the complement of the operand and
+// of the carry-in, the Carry is the complement of the carry out of bit 7.
+static uint8_t refArithmetic(uint8_t f, uint8_t a, uint8_t b, uint8_t carry,
+							 uint8_t isSubtraction)
+{
+	uint8_t operand = isSubtraction ? ~b : b;
+	uint8_t carryIn = isSubtraction ? !carry : carry;
+	uint8_t result = 0;
+	uint8_t bitCarry = carryIn;
+
+	for (int i = 0; i < 8; i++) {
+		uint8_t sum = (a >> i & 1) + (operand >> i & 1) + bitCarry;
+
+		result |= (sum & 1) << i;
+		bitCarry = sum >> 1;
+
+		// Carry out of bit 3
+		if (i == 3) {
+			refSet(&f, AUXCARRY, bitCarry);
+		}
+	}
+
+	refSet(&f, CARRY, bitCarry != isSubtraction);
+	refSZP(&f, result);
+
+	return f;
+}
+
+// INR/DCR, the Carry is not affected
+static uint8_t refIncrement(uint8_t f, uint8_t value, uint8_t isDecrement)
+{
+	uint8_t carry = f & CARRY;
+
+	f = refArithmetic(f, value, 1, 0, isDecrement);
+	refSet(&f, CARRY, carry);
+
+	return f;
+}
+
+// ANA/ANI, the Auxiliary Carry is the OR of bit 3 of the operands
+static uint8_t refAnd(uint8_t f, uint8_t a, uint8_t value)
+{
+	refSet(&f, AUXCARRY, (a | value) & 0x08);
+	refSet(&f, CARRY, 0);
+	refSZP(&f, a & value);
+
+	return f;
+}
+
+// XRA, XRI, ORA, ORI
+static uint8_t refLogic(uint8_t f, uint8_t result)
+{
+	refSet(&f, CARRY, 0);
+	refSet(&f, AUXCARRY, 0);
+	refSZP(&f, result);
+
+	return f;
+}
+
+static void check(const char *what, uint8_t a, uint8_t b, uint8_t f,
+				  uint8_t expected, uint8_t actual)
+{
+	if (expected != actual && failures++ < 20) {
+		printf("%s %02X, %02X (flags %02X): expected %02X, got %02X\n", what,
+			   a, b, f, expected, actual);
+	}
+}
+
+// The flags of a lazy record made with the flags f, all at once and one by
+// one
+static void checkLazy(const char *what, uint8_t a, uint8_t b, uint8_t f,
+					  uint8_t expected, enum LAZY_OP op, uint8_t byte1,
+					  uint8_t byte2, uint8_t carry, uint8_t result)
+{
+	static const enum FLAGS flags[] = { CARRY, PARITY, AUXCARRY, ZERO, SIGN };
+	lazy_flags_t lazy = { .op = LAZY_NONE };
+
+	lazy_record(&lazy, f, op, byte1, byte2, carry, result);
+	check(what, a, b, f, expected, lazy_get_flags(f, &lazy));
+	check(what, a, b, f, expected & CARRY, lazy_get_carry(f, &lazy));
+
+	for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+		check(what, a, b, f, expected & flags[i],
+			  lazy_get_flag(f, &lazy, flags[i]) ? flags[i] : 0);
+	}
+}
+
+static void testTables(void)
+{
+	for (int value = 0; value < 256; value++) {
+		uint8_t f = 0;
+		refSZP(&f, value);
+		check("szp_table", value, 0, 0, f, szp_table[value]);
+	}
+
+	for (int carry = 0; carry <= 1; carry++) {
+		for (int byte1 = 0; byte1 < 16; byte1++) {
+			for (int byte2 = 0; byte2 < 16; byte2++) {
+				uint8_t add = refArithmetic(0, byte1, byte2, carry, 0);
+				uint8_t sub = refArithmetic(0, byte1, byte2, carry, 1);
+
+				check("halfcarry_add_table", byte1, byte2, carry,
+					  add & AUXCARRY,
+					  halfcarry_add_table[NIBBLE_INDEX(byte1, byte2, carry)]);
+				check("halfcarry_sub_table", byte1, byte2, carry,
+					  sub & AUXCARRY,
+					  halfcarry_sub_table[NIBBLE_INDEX(byte1, byte2, carry)]);
+			}
+		}
+	}
+}
+
+static void testPair(uint8_t a, uint8_t b, uint8_t f)
+{
+	cpu_t cpu;
+
+	for (uint8_t carry = 0; carry <= 1; carry++) {
+		uint8_t sum = a + b + carry;
+		uint8_t difference = a - b - carry;
+		uint8_t expected = refArithmetic(f, a, b, carry, 0);
+
+		cpu.AF.lowByte = f;
+		update_flags(&cpu, FLAGS_ALL, flags_add8(a, b, carry, sum));
+		check(carry ? "ADC" : "ADD", a, b, f, expected, cpu.AF.lowByte);
+		checkLazy(carry ? "lazy ADC" : "lazy ADD", a, b, f, expected,
+				  LAZY_ADD, a, b, carry, sum);
+
+		expected = refArithmetic(f, a, b, carry, 1);
+
+		cpu.AF.lowByte = f;
+		update_flags(&cpu, FLAGS_ALL, flags_sub8(a, b, carry, difference));
+		check(carry ? "SBB" : "SUB", a, b, f, expected, cpu.AF.lowByte);
+		checkLazy(carry ? "lazy SBB" : "lazy SUB", a, b, f, expected,
+				  LAZY_SUB, a, b, carry, difference);
+	}
+
+	checkLazy("lazy ANA", a, b, f, refAnd(f, a, b), LAZY_ANA, a, b, 0, a & b);
+	checkLazy("lazy ORA", a, b, f, refLogic(f, a | b), LAZY_LOGIC, a, b, 0,
+			  a | b);
+	checkLazy("lazy XRA", a, b, f, refLogic(f, a ^ b), LAZY_LOGIC, a, b, 0,
+			  a ^ b);
+}
+
+static void testIncrement(uint8_t value, uint8_t f)
+{
+	cpu_t cpu;
+	uint8_t inr = value + 1;
+	uint8_t dcr = value - 1;
+	uint8_t expected = refIncrement(f, value, 0);
+
+	cpu.AF.lowByte = f;
+	update_flags(&cpu, SIGN | ZERO | AUXCARRY | PARITY,
+				 szp_table[inr] |
+					 halfcarry_add_table[NIBBLE_INDEX(value, 1, 0)]);
+	check("INR", value, 1, f, expected, cpu.AF.lowByte);
+	checkLazy("lazy INR", value, 1, f, expected, LAZY_INR, value, 1, 0, inr);
+
+	expected = refIncrement(f, value, 1);
+
+	cpu.AF.lowByte = f;
+	update_flags(&cpu, SIGN | ZERO | AUXCARRY | PARITY,
+				 szp_table[dcr] |
+					 halfcarry_sub_table[NIBBLE_INDEX(value, 1, 0)]);
+	check("DCR", value, 1, f, expected, cpu.AF.lowByte);
+	checkLazy("lazy DCR", value, 1, f, expected, LAZY_DCR, value, 1, 0, dcr);
+}
+
+int main(void)
+{
+	testTables();
+
+	for (size_t i = 0; i < sizeof(initialFlags); i++) {
+		for (int a = 0; a < 256; a++) {
+			testIncrement(a, initialFlags[i]);
+
+			for (int b = 0; b < 256; b++) {
+				testPair(a, b, initialFlags[i]);
+			}
+		}
+	}
+
+	if (failures) {
+		printf("%d mismatches\n", failures);
+		return EXIT_FAILURE;
+	}
+
+	printf("All flags match the reference implementation\n");
+	return EXIT_SUCCESS;
+}
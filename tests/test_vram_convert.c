@@ -0,0 +1,115 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vram_convert.h"
+
+/*
+ *  Checks that every VRAM conversion kernel the host supports produces the
+ *  same framebuffer as the scalar one, for random VRAM and dirty stripe
+ *  masks. The stripes that are not converted have to stay untouched.
+ */
+
+#define VRAM_SIZE (SCREEN_WIDTH / 8 * SCREEN_HEIGHT)
+#define PIXELS (SCREEN_WIDTH * SCREEN_HEIGHT)
+#define ROUNDS 200
+
+static const struct {
+	vram_kernel_t kernel;
+	const char *name;
+} kernels[] = {
+	{ VRAM_KERNEL_SSE2, "SSE2" },
+	{ VRAM_KERNEL_AVX2, "AVX2" },
+};
+
+static uint8_t vram[VRAM_SIZE];
+static uint32_t initial[PIXELS];
+static uint32_t expected[PIXELS];
+static uint32_t actual[PIXELS];
+
+// xorshift64, the same sequence on every run
+static uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t nextRandom(void)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+// Mostly random masks, plus the ones at the edges
+static uint32_t getStripes(int round)
+{
+	switch (round) {
+	case 0:
+		return 0xFFFFFFFF;
+	case 1:
+		return 0;
+	case 2:
+		return 0x80000001;
+	default:
+		return (uint32_t)nextRandom() & (uint32_t)nextRandom();
+	}
+}
+
+// Convert the stripes of vram over a copy of initial
+static void convert(uint32_t stripes, uint32_t *pixels)
+{
+	memcpy(pixels, initial, sizeof(initial));
+	convertVRAMStripes(vram, pixels, stripes);
+}
+
+// Returns 0 if the kernel differs from the scalar one
+static int testKernel(vram_kernel_t kernel, const char *name)
+{
+	for (int round = 0; round < ROUNDS; round++) {
+		uint32_t stripes = getStripes(round);
+
+		for (int i = 0; i < VRAM_SIZE; i++) {
+			vram[i] = nextRandom();
+		}
+
+		// Garbage in the framebuffer, only the stripes may change
+		for (int i = 0; i < PIXELS; i++) {
+			initial[i] = nextRandom();
+		}
+
+		setVRAMKernel(VRAM_KERNEL_SCALAR);
+		convert(stripes, expected);
+		setVRAMKernel(kernel);
+		convert(stripes, actual);
+
+		if (memcmp(expected, actual, sizeof(actual)) != 0) {
+			printf("%s: differs from scalar in round %d (stripes %08X)\n",
+				   name, round, stripes);
+			return 0;
+		}
+	}
+
+	printf("%s: %d rounds identical to scalar\n", name, ROUNDS);
+	return 1;
+}
+
+int main(void)
+{
+	int passed = 1;
+
+	if (!setVRAMKernel(VRAM_KERNEL_SCALAR)) {
+		fprintf(stderr, "Scalar kernel not available!\n");
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++) {
+		if (!setVRAMKernel(kernels[i].kernel)) {
+			printf("%s: not supported by this host, skipped\n",
+				   kernels[i].name);
+			continue;
+		}
+
+		passed &= testKernel(kernels[i].kernel, kernels[i].name);
+	}
+
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
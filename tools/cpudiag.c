@@ -0,0 +1,248 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bus.h"
+#include "cpu.h"
+#include "host_time.h"
+#include "machine.h"
+#include "profile.h"
+#include "trace.h"
+
+/*
+ *  Runs CP/M CPU test programs (CPUDIAG, TST8080, 8080PRE, CPUTEST,
+ *  8080EXM, ...) on the CPU core.
+ *
+ *  Usage: cpudiag [--step-cycles] <program.com> [expected cycles]
+ *
+ *  The machine has 64 KB of flat memory (see mapFlatMemory()) with the
+ *  program at 0x100 and just enough of CP/M around it:
+ *
+ *      0000 HLT          warm boot, the run ends when PC gets here
+ *      0005 JMP BDOS     0006/0007 is the top of the usable memory
+ *      F000 HLT          BDOS, the console functions are handled in C
+ *      F001 RET
+ *
+ *  The program runs on step(), or with --step-cycles on step_cycles(), the
+ *  batched interpreter the emulator uses (and the dynarec, in a DYNAREC
+ *  build, for the code it can translate). Both take the same cycles.
+ *
+ *  A program passes if it gets back to CP/M without printing ERROR or FAIL
+ *  and, if given, took the expected number of cycles. Known counts:
+ *
+ *      TST8080.COM          4924
+ *      8080PRE.COM          7817
+ *      CPUTEST.COM     255653383
+ *      8080EXM.COM   23803381171
+ */
+
+#define PROGRAM_START 0x100
+#define BDOS_ADDRESS 0xF000
+// Way more than the longest test needs, in case a program never returns
+#define MAX_CYCLES 100000000000ULL
+// Budget of one step_cycles() call
+#define SLICE_CYCLES 100000
+
+static uint8_t memory[0x10000];
+static uint8_t savedMemory[0x10000];
+static machine_t machine;
+
+// Everything the program printed, for the pass/fail check
+static char output[0x10000];
+static size_t outputLength = 0;
+
+static void printChar(char c)
+{
+	putchar(c);
+
+	if (outputLength < sizeof(output) - 1) {
+		output[outputLength++] = c;
+	}
+}
+
+// Console functions of the BDOS, the function is in C. Leaves PC at the
+// RET behind the HLT, or at 0 for a system reset.
+static void callBDOS(cpu_t *cpu)
+{
+	switch (cpu->BC.lowByte) {
+	case 0: // System reset
+		cpu->PC = 0;
+		return;
+	case 2: // Console output of E
+		printChar(cpu->DE.lowByte);
+		break;
+	case 9: // Print the string at DE up to '$'
+		for (uint16_t address = cpu->DE.reg; memory[address] != '$';
+			 address++) {
+			printChar(memory[address]);
+		}
+		break;
+	default:
+		fprintf(stderr, "Unsupported BDOS function %u\n", cpu->BC.lowByte);
+		CPU_CRASH(cpu);
+	}
+
+	cpu->PC = BDOS_ADDRESS + 1;
+	fflush(stdout);
+}
+
+static void loadProgram(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not open program: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+
+	size_t size = fread(&memory[PROGRAM_START], 1,
+						BDOS_ADDRESS - PROGRAM_START, file);
+	fclose(file);
+
+	if (size == 0) {
+		fprintf(stderr, "Failed to read program: %s\n", path);
+		exit(EXIT_FAILURE);
+	}
+}
+
+// Run the program with step(), returns the cycles it took
+static uint64_t runSteps(cpu_t *cpu)
+{
+	uint64_t cycles = 0;
+
+	// A HLT with interrupts disabled would never end
+	while (cpu->PC != 0 && !(cpu->halted && !cpu->interrupt_enabled) &&
+		   cycles < MAX_CYCLES) {
+		if (cpu->PC == BDOS_ADDRESS) {
+			callBDOS(cpu);
+			continue;
+		}
+
+		cycles += step(cpu);
+	}
+
+	return cycles;
+}
+
+// Run the program with step_cycles(), returns the cycles it took. A slice
+// that gets to one of the HLTs would execute it until the budget is used
+// up, so it is run again from a copy of the state before it, one
+// instruction per call up to the HLT. (A PROFILE or TRACE build records
+// those instructions twice.)
+static uint64_t runSlices(cpu_t *cpu)
+{
+	uint64_t cycles = 0;
+
+	while (cpu->PC != 0 && cycles < MAX_CYCLES) {
+		cpu_t saved = *cpu;
+		memcpy(savedMemory, memory, sizeof(memory));
+
+		uint32_t slice = step_cycles(cpu, SLICE_CYCLES);
+
+		if (!cpu->halted) {
+			cycles += slice;
+			continue;
+		}
+
+		*cpu = saved;
+		memcpy(memory, savedMemory, sizeof(memory));
+
+		while (cpu->PC != 0 && cpu->PC != BDOS_ADDRESS && !cpu->halted) {
+			cycles += step_cycles(cpu, 1);
+		}
+
+		// There are no interrupts to end any other HLT
+		if (cpu->PC != BDOS_ADDRESS) {
+			break;
+		}
+
+		callBDOS(cpu);
+	}
+
+	return cycles;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *name = argv[0];
+	uint8_t useSlices = argc > 1 && strcmp(argv[1], "--step-cycles") == 0;
+
+	argc -= useSlices;
+	argv += useSlices;
+
+	if (argc != 2 && argc != 3) {
+		fprintf(stderr,
+				"Usage: %s [--step-cycles] <program.com> [expected cycles]\n",
+				name);
+		return EXIT_FAILURE;
+	}
+
+	initMachine(&machine);
+	mapFlatMemory(&machine.bus, memory);
+	loadProgram(argv[1]);
+
+	memory[0x0000] = 0x76; // HLT
+	memory[0x0005] = 0xC3; // JMP BDOS_ADDRESS
+	memory[0x0006] = BDOS_ADDRESS & 0xFF;
+	memory[0x0007] = BDOS_ADDRESS >> 8;
+	memory[BDOS_ADDRESS] = 0x76; // HLT
+	memory[BDOS_ADDRESS + 1] = 0xC9; // RET
+
+	cpu_t *cpu = &machine.cpu;
+
+	// Returning from the program is a warm boot as well
+	cpu->SP = BDOS_ADDRESS - 2;
+	cpu->PC = PROGRAM_START;
+
+	uint64_t start = getTimeNS();
+	uint64_t cycles = useSlices ? runSlices(cpu) : runSteps(cpu);
+	double seconds = (getTimeNS() - start) / 1e9;
+	uint64_t instructions = cpu->instructions;
+	uint8_t passed = cpu->PC == 0;
+
+	if (!passed) {
+		printf("\nDid not return to CP/M, stopped at %04X\n", cpu->PC);
+	}
+
+	output[outputLength] = '\0';
+
+	if (strstr(output, "ERROR") || strstr(output, "FAIL")) {
+		passed = 0;
+	}
+
+	printf("\n%s:\n", argv[1]);
+	printf("  Instructions:    %llu\n", (unsigned long long)instructions);
+	printf("  Cycles:          %llu", (unsigned long long)cycles);
+
+	if (argc == 3) {
+		uint64_t expected = strtoull(argv[2], NULL, 0);
+
+		printf(" (expected %llu)", (unsigned long long)expected);
+		passed = passed && cycles == expected;
+	}
+
+	printf("\n");
+	printf("  Host time:       %.3f s\n", seconds);
+
+	if (seconds > 0) {
+		printf("  Emulated MHz:    %.2f\n", cycles / seconds / 1e6);
+		printf("  ns/instruction:  %.2f\n", seconds * 1e9 / instructions);
+	}
+
+	printf("  Result:          %s\n", passed ? "PASS" : "FAIL");
+
+#ifdef CPU_PROFILE
+	writeProfile(machine.profile);
+#endif
+#ifdef CPU_TRACE
+	if (!passed) {
+		writeTrace(machine.trace);
+	}
+#endif
+	freeMachine(&machine);
+
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,338 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "opcode_info.h"
+#include "rom_cache.h"
+
+/*
+ *  Ahead of time recompiler for the ROM.
+ *
+ *  Usage: recompile <rom> <output.c>
+ *
+ *  Follows the control flow from the reset and RST vectors and writes every
+ *  reachable basic block as C code using the instruction macros of
+ *  cpu_ops.h. The generated runRecompiled() is used by step_cycles() in the
+ *  SeaInvadersAOT build if the loaded ROM has the same hash. Jumps to
+ *  addresses that were not found (RET, PCHL, code in RAM, the middle of a
+ *  block after an interrupt) go through step().
+ */
+
+static uint8_t rom[ROM_SIZE];
+static uint8_t leader[ROM_SIZE]; // A block starts here
+static uint8_t visited[ROM_SIZE];
+
+static uint16_t worklist[ROM_SIZE];
+static int worklistCount = 0;
+
+// instruction: enum INSTRUCTION
+static uint8_t isInstruction(uint16_t address, uint8_t instruction)
+{
+	return opcodeInfo[rom[address]].instruction == instruction;
+}
+
+static uint16_t operandAt(uint16_t address)
+{
+	return rom[address + 1] | rom[address + 2] << 8;
+}
+
+// The whole instruction has to be in the ROM
+static uint8_t inROM(uint16_t address)
+{
+	return address < ROM_SIZE &&
+		   address + opcodeInfo[rom[address]].length <= ROM_SIZE;
+}
+
+static void addLeader(uint16_t address)
+{
+	if (!inROM(address) || leader[address]) {
+		return;
+	}
+
+	leader[address] = 1;
+	worklist[worklistCount++] = address;
+}
+
+// Blocks end at every instruction that may not continue with the next one,
+// and at EI because a pending interrupt has to be taken after it
+static uint8_t endsBlock(uint16_t address)
+{
+	switch (opcodeInfo[rom[address]].instruction) {
+	case INSTR_JMP:
+	case INSTR_JMPC:
+	case INSTR_CALL:
+	case INSTR_CALLC:
+	case INSTR_RET:
+	case INSTR_RETC:
+	case INSTR_RST:
+	case INSTR_PCHL:
+	case INSTR_HLT:
+	case INSTR_EI:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static void findBlocks(void)
+{
+	for (uint16_t vector = 0; vector <= 0x38; vector += 8) {
+		addLeader(vector);
+	}
+
+	while (worklistCount > 0) {
+		uint16_t address = worklist[--worklistCount];
+
+		while (inROM(address) && !visited[address]) {
+			const opcode_info_t *info = &opcodeInfo[rom[address]];
+			uint16_t next = address + info->length;
+
+			visited[address] = 1;
+
+			if (!endsBlock(address)) {
+				address = next;
+				continue;
+			}
+
+			if (isInstruction(address, INSTR_JMP)) {
+				addLeader(operandAt(address));
+			} else if (isInstruction(address, INSTR_JMPC) ||
+					   isInstruction(address, INSTR_CALL) ||
+					   isInstruction(address, INSTR_CALLC)) {
+				addLeader(operandAt(address));
+				addLeader(next);
+			} else if (isInstruction(address, INSTR_RST)) {
+				addLeader(rom[address] & 0x38);
+				addLeader(next);
+			} else if (isInstruction(address, INSTR_RETC) ||
+					   isInstruction(address, INSTR_EI)) {
+				addLeader(next);
+			}
+
+			break;
+		}
+	}
+}
+
+// Continue with the block at address, or let the dispatcher find out
+static void writeGoto(FILE *out, uint16_t address)
+{
+	if (address < ROM_SIZE && leader[address]) {
+		fprintf(out, "\t\tgoto block_%04X;\n", address);
+	} else {
+		fprintf(out, "\t\tcontinue;\n");
+	}
+}
+
+static void writeBlock(FILE *out, uint16_t start)
+{
+	uint16_t address = start;
+	uint32_t count = 0;
+	uint32_t maxCycles = 0;
+
+	// Find the end and the worst case cycles first
+	for (;;) {
+		const opcode_info_t *info = &opcodeInfo[rom[address]];
+
+		count++;
+		maxCycles += info->cycles;
+
+		if (isInstruction(address, INSTR_CALLC) ||
+			isInstruction(address, INSTR_RETC)) {
+			maxCycles += 6;
+		}
+
+		uint16_t next = address + info->length;
+
+		if (endsBlock(address) || !inROM(next) || leader[next]) {
+			break;
+		}
+
+		address = next;
+	}
+
+	fprintf(out, "\tblock_%04X:\n", start);
+	fprintf(out, "\t\tif (cycles + %u >= budget) {\n", maxCycles);
+	fprintf(out, "\t\t\tcycles += step(cpu);\n");
+	fprintf(out, "\t\t\tcontinue;\n");
+	fprintf(out, "\t\t}\n");
+	fprintf(out, "\t\tcpu->instructions += %u;\n", count);
+
+	for (address = start;;) {
+		uint8_t opcode = rom[address];
+		const opcode_info_t *info = &opcodeInfo[opcode];
+		uint16_t next = address + info->length;
+
+		if (info->length > 1) {
+			fprintf(out, "\t\toperand = 0x%04X;\n", operandAt(address));
+		}
+
+		fprintf(out, "\t\tOP_%s(%s, %s); // %04X\n", info->name,
+				info->xName, info->yName, address);
+		fprintf(out, "\t\tcycles += %u;\n", info->cycles);
+
+		if (isInstruction(address, INSTR_JMP) ||
+			isInstruction(address, INSTR_CALL)) {
+			writeGoto(out, operandAt(address));
+			return;
+		}
+
+		if (isInstruction(address, INSTR_JMPC) ||
+			isInstruction(address, INSTR_CALLC)) {
+			fprintf(out, "\t\tif (cpu->PC == 0x%04X)\n", operandAt(address));
+			fprintf(out, "\t");
+			writeGoto(out, operandAt(address));
+			writeGoto(out, next);
+			return;
+		}
+
+		if (isInstruction(address, INSTR_RETC)) {
+			fprintf(out, "\t\tif (cpu->PC == 0x%04X)\n", next);
+			fprintf(out, "\t");
+			writeGoto(out, next);
+			fprintf(out, "\t\tcontinue;\n");
+			return;
+		}
+
+		if (isInstruction(address, INSTR_RST)) {
+			writeGoto(out, opcode & 0x38);
+			return;
+		}
+
+		if (endsBlock(address)) {
+			fprintf(out, "\t\tcontinue;\n");
+			return;
+		}
+
+		if (!inROM(next) || leader[next]) {
+			writeGoto(out, next);
+			return;
+		}
+
+		address = next;
+	}
+}
+
+static void writeSource(FILE *out)
+{
+	fprintf(out, "// Generated by recompile, do not edit\n\n");
+	fprintf(out, "#include <stdint.h>\n\n");
+	fprintf(out, "#include \"cpu.h\"\n");
+	fprintf(out, "#include \"cpu_ops.h\"\n");
+	fprintf(out, "#include \"machine.h\"\n");
+	fprintf(out, "#include \"recompiled.h\"\n\n");
+
+	fprintf(out, "const uint64_t recompiledROMHash = 0x%016llXULL;\n\n",
+			(unsigned long long)hashBytes(rom, ROM_SIZE));
+
+	static const char *const bindings[][2] = {
+		{ "REG_A", "cpu->AF.highByte" },
+		{ "REG_F", "cpu->AF.lowByte" },
+		{ "REG_B", "cpu->BC.highByte" },
+		{ "REG_C", "cpu->BC.lowByte" },
+		{ "REG_D", "cpu->DE.highByte" },
+		{ "REG_E", "cpu->DE.lowByte" },
+		{ "REG_H", "cpu->HL.highByte" },
+		{ "REG_L", "cpu->HL.lowByte" },
+		{ "REG_BC", "cpu->BC.reg" },
+		{ "REG_DE", "cpu->DE.reg" },
+		{ "REG_HL", "cpu->HL.reg" },
+		{ "REG_SP", "cpu->SP" },
+		{ "REG_PC", "cpu->PC" },
+		{ "LAZY", "cpu->lazy" },
+		{ "INT_ENABLED", "cpu->interrupt_enabled" },
+		{ "HALTED", "cpu->halted" },
+		{ "CYCLES", "cycles" },
+		{ "MACHINE", "machine" },
+		{ "CRASH()", "CPU_CRASH(cpu)" },
+	};
+
+	for (size_t i = 0; i < sizeof(bindings) / sizeof(bindings[0]); i++) {
+		fprintf(out, "#define %s %s\n", bindings[i][0], bindings[i][1]);
+	}
+
+	// The operands are constants
+	fprintf(out, "#undef IMM8\n#undef IMM16\n");
+	fprintf(out, "#define IMM8() ((uint8_t)operand)\n");
+	fprintf(out, "#define IMM16() operand\n\n");
+
+	fprintf(out, "uint32_t runRecompiled(cpu_t *cpu, uint32_t budget)\n{\n");
+	fprintf(out, "\tmachine_t *machine = cpu->machine;\n");
+	fprintf(out, "\tuint32_t cycles = 0;\n");
+	fprintf(out, "\tuint16_t operand;\n\n");
+	fprintf(out, "\twhile (cycles < budget) {\n");
+	fprintf(out, "\t\tif (cpu->interrupt_enabled && cpu->interrupt) {\n");
+	fprintf(out, "\t\t\tcycles += step(cpu);\n");
+	fprintf(out, "\t\t\tcontinue;\n");
+	fprintf(out, "\t\t}\n\n");
+	fprintf(out, "\t\tswitch (cpu->PC) {\n");
+
+	for (int address = 0; address < ROM_SIZE; address++) {
+		if (leader[address]) {
+			fprintf(out, "\t\tcase 0x%04X:\n\t\t\tgoto block_%04X;\n", address,
+					address);
+		}
+	}
+
+	fprintf(out, "\t\tdefault:\n");
+	fprintf(out, "\t\t\tcycles += step(cpu);\n");
+	fprintf(out, "\t\t\tcontinue;\n");
+	fprintf(out, "\t\t}\n\n");
+
+	for (int address = 0; address < ROM_SIZE; address++) {
+		if (leader[address]) {
+			writeBlock(out, address);
+			fprintf(out, "\n");
+		}
+	}
+
+	fprintf(out, "\t}\n\n\treturn cycles;\n}\n");
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <rom> <output.c>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FILE *file = fopen(argv[1], "rb");
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not open ROM: %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	// Shorter ROMs are zero padded like in memory_t
+	size_t size = fread(rom, 1, sizeof(rom), file);
+	fclose(file);
+
+	if (size == 0) {
+		fprintf(stderr, "Failed to read ROM: %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	findBlocks();
+
+	FILE *out = fopen(argv[2], "w");
+
+	if (NULL == out) {
+		fprintf(stderr, "Could not create %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	writeSource(out);
+	fclose(out);
+
+	int blocks = 0;
+	int instructions = 0;
+
+	for (int address = 0; address < ROM_SIZE; address++) {
+		blocks += leader[address];
+		instructions += visited[address];
+	}
+
+	printf("Recompiled %d instructions in %d blocks\n", instructions, blocks);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opcode_info.h"
+#include "trace.h"
+
+/*
+ *  Disassembles an instruction trace written by a -DTRACE=ON build (see
+ *  trace.h).
+ *
+ *  Usage: tracedump <trace.bin> [last entries]
+ *
+ *  One line per instruction with its number, the cycles since the first
+ *  entry of the file, the address, the bytes, the instruction and the
+ *  registers before it was executed:
+ *
+ *      Number      Cycle  PC    Bytes     Instruction  A  Flags BC   ...
+ *      112565      20064  0ADE  C2 DA 0A  JNZ $0ADA    2D --AP- 0000 ...
+ *
+ *  Opcodes injected by an interrupt are marked with "interrupt" and show
+ *  the address the interrupt came at.
+ */
+
+// opcodes.h names the register pairs BC, DE and HL, the assembler B, D, H
+static const char *operandName(uint8_t operand, const char *name)
+{
+	switch (operand) {
+	case OPERAND_BC:
+		return "B";
+	case OPERAND_DE:
+		return "D";
+	case OPERAND_HL:
+		return "H";
+	default:
+		return name;
+	}
+}
+
+// Write the instruction in 8080 assembler syntax into text
+static void disassemble(const trace_entry_t *entry, char *text, size_t size)
+{
+	const opcode_info_t *info = &opcodeInfo[entry->opcode];
+	uint16_t operand = entry->operand[0] | entry->operand[1] << 8;
+	char name[8];
+	char operands[16] = "";
+
+	// JMPC NZ is JNZ, CALLC Z is CZ and RETC C is RC
+	if (isConditional(info->instruction)) {
+		snprintf(name, sizeof(name), "%c%s", info->name[0], info->xName);
+	} else {
+		snprintf(name, sizeof(name), "%s", info->name);
+
+		if (info->x != OPERAND__) {
+			snprintf(operands, sizeof(operands), "%s",
+					 operandName(info->x, info->xName));
+		}
+
+		if (info->y != OPERAND__) {
+			size_t length = strlen(operands);
+			snprintf(operands + length, sizeof(operands) - length, ",%s",
+					 operandName(info->y, info->yName));
+		}
+	}
+
+	if (info->length > 1) {
+		size_t length = strlen(operands);
+		snprintf(operands + length, sizeof(operands) - length,
+				 info->length == 2 ? "%s$%02X" : "%s$%04X",
+				 length ? "," : "",
+				 info->length == 2 ? operand & 0xFF : operand);
+	}
+
+	snprintf(text, size, "%s%s%s", name, operands[0] ? " " : "", operands);
+}
+
+static void printEntry(const trace_entry_t *entry, uint64_t number,
+					   uint64_t cycle)
+{
+	const opcode_info_t *info = &opcodeInfo[entry->opcode];
+	uint8_t interrupt = entry->cycles & TRACE_INTERRUPT;
+	char bytes[12] = "";
+	char text[24];
+	char flags[6];
+
+	if (!interrupt) {
+		snprintf(bytes, sizeof(bytes), "%02X", entry->opcode);
+
+		for (int i = 1; i < info->length; i++) {
+			size_t length = strlen(bytes);
+			snprintf(bytes + length, sizeof(bytes) - length, " %02X",
+					 entry->operand[i - 1]);
+		}
+	}
+
+	disassemble(entry, text, sizeof(text));
+
+	// Sign, Zero, Auxiliary Carry, Parity and Carry (see flags.h)
+	static const uint8_t bits[5] = { 0x80, 0x40, 0x10, 0x04, 0x01 };
+
+	for (int i = 0; i < 5; i++) {
+		flags[i] = entry->f & bits[i] ? "SZAPC"[i] : '-';
+	}
+
+	flags[5] = '\0';
+
+	printf("%10llu %10llu  %04X  %-8s  %-12s %02X %s %04X %04X %04X %04X  "
+		   "%2u%s\n",
+		   (unsigned long long)number, (unsigned long long)cycle, entry->pc,
+		   bytes, text, entry->a, flags, entry->bc, entry->de, entry->hl,
+		   entry->sp, entry->cycles & ~TRACE_INTERRUPT,
+		   interrupt ? "  interrupt" : "");
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2 && argc != 3) {
+		fprintf(stderr, "Usage: %s <trace.bin> [last entries]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FILE *file = fopen(argv[1], "rb");
+	trace_header_t header;
+
+	if (NULL == file) {
+		fprintf(stderr, "Could not open trace: %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	if (1 != fread(&header, sizeof(header), 1, file) ||
+		header.magic != TRACE_MAGIC || header.version != TRACE_VERSION ||
+		header.entrySize != sizeof(trace_entry_t)) {
+		fprintf(stderr, "Not a trace file: %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	uint64_t skip = 0;
+
+	if (argc == 3) {
+		uint64_t last = strtoull(argv[2], NULL, 0);
+		skip = last < header.count ? header.count - last : 0;
+	}
+
+	printf("%llu instructions, %llu to %llu\n\n",
+		   (unsigned long long)header.count, (unsigned long long)header.first,
+		   (unsigned long long)(header.first + header.count - 1));
+	printf("    Number      Cycle  PC    Bytes     Instruction  A  Flags "
+		   "BC   DE   HL   SP    Cycles\n");
+
+	trace_entry_t entry;
+	uint64_t cycle = 0;
+
+	// The cycles of the skipped entries still count
+	for (uint64_t i = 0; i < header.count; i++) {
+		if (1 != fread(&entry, sizeof(entry), 1, file)) {
+			fprintf(stderr, "Trace is truncated after %llu entries\n",
+					(unsigned long long)i);
+			return EXIT_FAILURE;
+		}
+
+		if (i >= skip) {
+			printEntry(&entry, header.first + i, cycle);
+		}
+
+		cycle += entry.cycles & ~TRACE_INTERRUPT;
+	}
+
+	fclose(file);
+
+	return EXIT_SUCCESS;
+}